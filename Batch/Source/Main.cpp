@@ -0,0 +1,405 @@
+/*
+  ==============================================================================
+
+    Offline batch processor: runs the EQ over many audio files at once.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <iostream>
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+//==============================================================================
+struct Options
+{
+	juce::StringArray inputs;
+	juce::File outputDir, presetFile;
+	int chunkSize = 65536;
+	int numThreads = juce::SystemStats::getNumCpus();
+};
+
+struct Task
+{
+	juce::File input, output;
+};
+
+//ChainSettings fields by the names a preset uses for them, the slopes are handled on their own
+struct PresetField
+{
+	const char* name;
+	float ChainSettings::* member;
+};
+
+const PresetField presetFields[] = { { "lowCutFreq", &ChainSettings::lowCutFreq },
+									 { "lowShelfFreq", &ChainSettings::lowShelfFreq },
+									 { "lowShelfGainDB", &ChainSettings::lowShelfGainDB },
+									 { "lowShelfQ", &ChainSettings::lowShelfQ },
+									 { "lowMidFreq", &ChainSettings::lowMidFreq },
+									 { "lowMidGainDB", &ChainSettings::lowMidGainDB },
+									 { "lowMidQ", &ChainSettings::lowMidQ },
+									 { "midFreq", &ChainSettings::midFreq },
+									 { "midGainDB", &ChainSettings::midGainDB },
+									 { "midQ", &ChainSettings::midQ },
+									 { "hiShelfFreq", &ChainSettings::hiShelfFreq },
+									 { "hiShelfGainDB", &ChainSettings::hiShelfGainDB },
+									 { "hiShelfQ", &ChainSettings::hiShelfQ },
+									 { "hiCutFreq", &ChainSettings::hiCutFreq } };
+
+//what every engine is set up with, the curve and everything else about how it runs
+struct Preset
+{
+	ChainSettings settings;
+	EQEngine::Options options;
+};
+
+//==============================================================================
+// A preset is a JSON object of ChainSettings fields, and optionally any other parameter by its ID, all as plain values.
+bool loadPreset(const juce::File& file, Preset& preset, juce::String& error)
+{
+	//only the parameter layout is used, for the defaults and to read other parameters as the plugin would
+	Parametric_EQ_PluginAudioProcessor processor;
+
+	if (file == juce::File())
+	{
+		preset = { getChainSettings(processor.apvts), getEngineOptions(processor.apvts) };
+		return true;
+	}
+
+	const auto json = juce::JSON::parse(file);
+	const auto* object = json.getDynamicObject();
+
+	if (object == nullptr)
+	{
+		error = "the preset is not a JSON object";
+		return false;
+	}
+
+	auto settings = getChainSettings(processor.apvts);
+
+	for (const auto& property : object->getProperties())
+	{
+		const auto name = property.name.toString();
+		const auto value = (float) property.value;
+		const auto* field = std::find_if(std::begin(presetFields), std::end(presetFields), [&name](const PresetField& f) { return name == f.name; });
+
+		if (field != std::end(presetFields))
+			settings.*(field->member) = value;
+		else if (name == "lowCutSlope")
+			settings.lowCutSlope = (Slope) juce::jlimit(0, 3, juce::roundToInt(value));
+		else if (name == "highCutSlope")
+			settings.highCutSlope = (Slope) juce::jlimit(0, 3, juce::roundToInt(value));
+		else if (auto* param = processor.apvts.getParameter(name))
+			param->setValueNotifyingHost(param->convertTo0to1(value));
+		else
+		{
+			error = "unknown preset field " + name;
+			return false;
+		}
+	}
+
+	preset = { settings, getEngineOptions(processor.apvts) };
+	return true;
+}
+
+//==============================================================================
+class Batch
+{
+public:
+	Batch(const Options& optionsToUse, const Preset& presetToUse)
+		: options(optionsToUse), preset(presetToUse)
+	{
+		formats.registerBasicFormats();
+
+		//the files already keep every core busy, so channel groups are only spread across threads when running one file at a time
+		preset.options.nonRealtime = options.numThreads == 1;
+
+		//just the signal path, no parameters or buses, one for each file that can be in flight and reused from file to file
+		for (int i = 0; i < options.numThreads; ++i)
+			idleEngines.push_back(std::make_unique<EQEngine>());
+	}
+
+	int run(const std::vector<Task>& tasks)
+	{
+		juce::ThreadPool pool(options.numThreads);
+		const auto start = std::chrono::steady_clock::now();
+
+		for (const auto& task : tasks)
+			pool.addJob([this, task] { processTask(task); });
+
+		while (pool.getNumJobs() > 0)
+			juce::Thread::sleep(50);
+
+		const auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const auto audioSeconds = processedSeconds;
+
+		std::cout << "files:    " << (int) tasks.size() - failures.load() << " processed, " << failures.load() << " failed\n"
+				  << "audio:    " << audioSeconds << " s in " << wallSeconds << " s\n"
+				  << "speed:    " << (wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0) << "x real time" << std::endl;
+
+		return failures.load() == 0 ? 0 : 1;
+	}
+
+private:
+	void processTask(const Task& task)
+	{
+		auto engine = acquireEngine();
+		juce::String error;
+
+		if (! processFile(*engine, task, error))
+		{
+			++failures;
+
+			const juce::ScopedLock sl(statsLock);
+			std::cerr << task.input.getFullPathName() << ": " << error << std::endl;
+		}
+
+		releaseEngine(std::move(engine));
+	}
+
+	bool processFile(EQEngine& engine, const Task& task, juce::String& error)
+	{
+		auto* format = formats.findFormatForFileExtension(task.input.getFileExtension());
+
+		if (format == nullptr)
+		{
+			error = "unsupported file type";
+			return false;
+		}
+
+		//formats that can be memory mapped are read straight from the mapping, one chunk sized section at a time,
+		//the rest through a buffered stream, so no file is ever loaded whole
+		std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(task.input));
+		std::unique_ptr<juce::AudioFormatReader> streamed;
+
+		if (mapped == nullptr)
+			if (auto stream = task.input.createInputStream())
+				streamed.reset(format->createReaderFor(new juce::BufferedInputStream(stream.release(), options.chunkSize * 4, true), true));
+
+		auto* reader = mapped != nullptr ? static_cast<juce::AudioFormatReader*>(mapped.get()) : streamed.get();
+
+		if (reader == nullptr)
+		{
+			error = "could not be read";
+			return false;
+		}
+
+		const auto numChannels = (int) reader->numChannels;
+		const auto sampleRate = reader->sampleRate;
+
+		//the same rate, channel count and chunk size as the last file prepares for nothing, only the previous file's tail is cleared
+		const EQEngine::Setup setup { sampleRate, options.chunkSize, numChannels, false };
+
+		if (! engine.isPrepared() || engine.getSetup() != setup)
+			engine.prepare(setup, preset.settings, preset.options);
+		else
+			engine.reset();
+
+		auto bitsPerSample = (int) reader->bitsPerSample;
+		const auto depths = format->getPossibleBitDepths();
+
+		if (! depths.contains(bitsPerSample))
+			bitsPerSample = depths.getLast();
+
+		//written next to the destination and moved over it once complete, so a failed file never leaves half an output behind
+		task.output.getParentDirectory().createDirectory();
+		juce::TemporaryFile temp(task.output);
+
+		std::unique_ptr<juce::OutputStream> stream(temp.getFile().createOutputStream((size_t) options.chunkSize * 4));
+		std::unique_ptr<juce::AudioFormatWriter> writer(stream != nullptr ? format->createWriterFor(stream.get(), sampleRate, (unsigned int) numChannels,
+																									bitsPerSample, reader->metadataValues, 0)
+																		   : nullptr);
+
+		if (writer == nullptr)
+		{
+			error = "could not write " + task.output.getFullPathName();
+			return false;
+		}
+
+		stream.release();
+
+		//the engine's latency is run out past the end of the input and cut from the start of the output
+		const auto latency = (juce::int64) engine.getLatencySamples();
+		const auto totalLength = reader->lengthInSamples + latency;
+		auto toSkip = latency;
+
+		juce::AudioBuffer<float> buffer(numChannels, options.chunkSize);
+
+		for (juce::int64 position = 0; position < totalLength; position += options.chunkSize)
+		{
+			const auto count = (int) juce::jmin((juce::int64) options.chunkSize, totalLength - position);
+			const auto available = (int) juce::jlimit((juce::int64) 0, (juce::int64) count, reader->lengthInSamples - position);
+
+			buffer.setSize(numChannels, count, false, false, true);
+			buffer.clear(available, count - available);
+
+			if (available > 0)
+			{
+				if (mapped != nullptr && ! mapped->mapSectionOfFile({ position, position + available }))
+				{
+					error = "could not be mapped";
+					return false;
+				}
+
+				if (! reader->read(&buffer, 0, available, position, true, true))
+				{
+					error = "read failed";
+					return false;
+				}
+			}
+
+			//the file is its own key for the dynamic bands
+			const auto block = juce::dsp::AudioBlock<float>(buffer);
+			engine.process(block, block);
+
+			const auto skip = (int) juce::jmin((juce::int64) count, toSkip);
+			toSkip -= skip;
+
+			if (count > skip && ! writer->writeFromAudioSampleBuffer(buffer, skip, count - skip))
+			{
+				error = "write failed";
+				return false;
+			}
+		}
+
+		writer.reset();
+
+		if (! temp.overwriteTargetFileWithTemporary())
+		{
+			error = "could not replace " + task.output.getFullPathName();
+			return false;
+		}
+
+		const juce::ScopedLock sl(statsLock);
+		processedSeconds += (double) reader->lengthInSamples / sampleRate;
+		return true;
+	}
+
+	std::unique_ptr<EQEngine> acquireEngine()
+	{
+		const juce::ScopedLock sl(engineLock);
+		jassert(! idleEngines.empty());
+
+		auto engine = std::move(idleEngines.back());
+		idleEngines.pop_back();
+		return engine;
+	}
+
+	void releaseEngine(std::unique_ptr<EQEngine> engine)
+	{
+		const juce::ScopedLock sl(engineLock);
+		idleEngines.push_back(std::move(engine));
+	}
+
+	const Options& options;
+	Preset preset;
+	juce::AudioFormatManager formats;
+
+	juce::CriticalSection engineLock, statsLock;
+	std::vector<std::unique_ptr<EQEngine>> idleEngines;
+
+	std::atomic<int> failures { 0 };
+	double processedSeconds = 0.0;
+};
+
+//==============================================================================
+std::vector<Task> collectTasks(const Options& options)
+{
+	std::vector<Task> tasks;
+	const auto cwd = juce::File::getCurrentWorkingDirectory();
+	const auto patterns = "*.wav;*.flac;*.aif;*.aiff";
+
+	for (const auto& input : options.inputs)
+	{
+		const auto file = cwd.getChildFile(input);
+
+		//folders are searched recursively, and their layout is kept under the output folder
+		if (file.isDirectory())
+		{
+			for (const auto& entry : juce::RangedDirectoryIterator(file, true, patterns, juce::File::findFiles))
+				tasks.push_back({ entry.getFile(), options.outputDir.getChildFile(entry.getFile().getRelativePathFrom(file)) });
+		}
+		else if (file.existsAsFile())
+		{
+			tasks.push_back({ file, options.outputDir.getChildFile(file.getFileName()) });
+		}
+		else
+		{
+			std::cerr << input << ": not found" << std::endl;
+		}
+	}
+
+	return tasks;
+}
+
+void printUsage()
+{
+	std::cout << "Parametric_EQ_Batch [options] <files or folders>\n"
+				 "  --out <dir>              where processed files go, under their own names (required)\n"
+				 "  --preset <file>          JSON of ChainSettings fields (lowCutFreq, midGainDB, lowCutSlope, ...)\n"
+				 "                           or parameter IDs (PHASEMODE, OVERSAMPLING, ...), as plain values\n"
+				 "  --threads 8              files processed at once, defaults to the number of cores\n"
+				 "  --chunk 65536            samples read, processed and written at a time\n";
+}
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	Options options;
+	const juce::StringArray args(argv + 1, argc - 1);
+
+	for (int i = 0; i < args.size(); ++i)
+	{
+		const auto& arg = args[i];
+		const auto next = args[i + 1];
+
+		if (arg == "--out")           { options.outputDir = juce::File::getCurrentWorkingDirectory().getChildFile(next); ++i; }
+		else if (arg == "--preset")   { options.presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(next); ++i; }
+		else if (arg == "--threads")  { options.numThreads = juce::jmax(1, next.getIntValue()); ++i; }
+		else if (arg == "--chunk")    { options.chunkSize = juce::jlimit(64, 1 << 20, next.getIntValue()); ++i; }
+		else if (! arg.startsWith("--"))
+		{
+			options.inputs.add(arg);
+		}
+		else
+		{
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	if (options.outputDir == juce::File() || options.inputs.isEmpty())
+	{
+		printUsage();
+		return 1;
+	}
+
+	Preset preset;
+	juce::String error;
+
+	if (! loadPreset(options.presetFile, preset, error))
+	{
+		std::cerr << options.presetFile.getFullPathName() << ": " << error << std::endl;
+		return 1;
+	}
+
+	const auto tasks = collectTasks(options);
+
+	for (const auto& task : tasks)
+	{
+		if (task.output == task.input)
+		{
+			std::cerr << task.input.getFullPathName() << ": the output folder would overwrite the input" << std::endl;
+			return 1;
+		}
+	}
+
+	Batch batch(options, preset);
+	return batch.run(tasks);
+}
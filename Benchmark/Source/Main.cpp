@@ -0,0 +1,735 @@
+/*
+  ==============================================================================
+
+    Headless benchmark and regression harness for the EQ processor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <iostream>
+#include "../../Source/PluginProcessor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+// Every allocation made while countAllocations is set on the calling thread is counted.
+// On Linux malloc, calloc and realloc are wrapped around glibc's own, which catches JUCE's HeapBlock
+// and AudioBuffer as well as operator new. Elsewhere only operator new is seen.
+namespace
+{
+	std::atomic<juce::int64> allocationCount { 0 };
+	thread_local bool countAllocations = false;
+
+	void countAllocation() noexcept
+	{
+		if (countAllocations)
+			++allocationCount;
+	}
+}
+
+#if JUCE_LINUX
+extern "C"
+{
+	void* __libc_malloc(std::size_t);
+	void* __libc_calloc(std::size_t, std::size_t);
+	void* __libc_realloc(void*, std::size_t);
+
+	void* malloc(std::size_t size)
+	{
+		countAllocation();
+		return __libc_malloc(size);
+	}
+
+	void* calloc(std::size_t count, std::size_t size)
+	{
+		countAllocation();
+		return __libc_calloc(count, size);
+	}
+
+	void* realloc(void* ptr, std::size_t size)
+	{
+		countAllocation();
+		return __libc_realloc(ptr, size);
+	}
+}
+#endif
+
+void* operator new(std::size_t size)
+{
+	//with malloc wrapped, the malloc below is what gets counted
+#if ! JUCE_LINUX
+	countAllocation();
+#endif
+
+	if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace
+{
+//==============================================================================
+juce::uint64 readCycleCounter() noexcept
+{
+#if JUCE_INTEL
+	return (juce::uint64) __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+struct Scenario
+{
+	double sampleRate = 48000.0;
+	int blockSize = 512;
+	int numChannels = 2;
+	int activeBands = 0;
+	double automationDensity = 0.0;
+	int oversampling = 1;
+	int firLength = 0;
+	int precision = 0;
+	int dynamicBands = 0;
+	int smoothingStep = 32;
+};
+
+//samples between coefficient rebuilds of a ramping band, in the order of the SMOOTHSTEP choices, 0 processes whole blocks
+const int smoothingSteps[] = { 0, 64, 32, 16, 8, 1 };
+
+//single and mixed run the host in float, double runs it in double with every band in double
+const char* const precisionNames[] = { "single", "mixed", "double" };
+
+struct Result
+{
+	bool ok = false;
+	double nsPerSample = 0;
+	double cyclesPerSample = 0;
+	double worstBlockNs = 0;
+	double allocationsPerBlock = 0;
+};
+
+struct Options
+{
+	juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0 };
+	juce::Array<int> blockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+	juce::Array<int> channelCounts { 1, 2, 6, 12 };
+	juce::Array<int> activeBands { 0, 1, 2, 4, 6 };
+	juce::Array<double> automationDensities { 0.0, 0.1, 1.0 };
+	juce::Array<int> oversampling { 1 };
+	juce::Array<int> firLengths { 0 };
+	juce::Array<int> precisions { 0 };
+	juce::Array<int> dynamicBands { 0 };
+	juce::Array<int> smoothingSteps { 32 };
+	double seconds = 1.0;
+	bool json = false;
+	bool offline = false;
+	bool instrument = false;
+	bool checkReference = false;
+	double tolerance = 1.0e-3;
+	int sessionInstances = 0;
+};
+
+//==============================================================================
+void setParameter(Parametric_EQ_PluginAudioProcessor& processor, const juce::String& id, float value)
+{
+	auto* param = processor.apvts.getParameter(id);
+	jassert(param != nullptr);
+	param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+//bands are switched on in this order, each to a setting that keeps it in the cascade
+void applyActiveBands(Parametric_EQ_PluginAudioProcessor& processor, int activeBands)
+{
+	struct BandSetting
+	{
+		const char* id;
+		float active, neutral;
+	};
+
+	static const BandSetting bands[] = { { "MIDPEAKGAIN", 6.0f, 0.0f },
+										 { "LOWMIDPEAKGAIN", -3.0f, 0.0f },
+										 { "LOWSHELFGAIN", 3.0f, 0.0f },
+										 { "HISHELFGAIN", -2.0f, 0.0f },
+										 { "LOWCUTFREQ", 80.0f, 20.0f },
+										 { "HICUTFREQ", 12000.0f, 20000.0f } };
+
+	for (int i = 0; i < (int) std::size(bands); ++i)
+		setParameter(processor, bands[i].id, i < activeBands ? bands[i].active : bands[i].neutral);
+}
+
+//makes peak and shelf bands dynamic in the order applyActiveBands switches them on, with a threshold the noise sits above
+void applyDynamicBands(Parametric_EQ_PluginAudioProcessor& processor, int dynamicBands)
+{
+	static const char* const bands[] = { "MIDPEAK", "LOWMIDPEAK", "LOWSHELF", "HISHELF" };
+
+	for (int i = 0; i < (int) std::size(bands); ++i)
+	{
+		setParameter(processor, juce::String(bands[i]) + "DYNRANGE", i < dynamicBands ? -6.0f : 0.0f);
+		setParameter(processor, juce::String(bands[i]) + "DYNTHRESHOLD", -40.0f);
+	}
+}
+
+//moves the mid peak around, as a host would while playing back an automation lane
+void automate(Parametric_EQ_PluginAudioProcessor& processor, int blockIndex)
+{
+	setParameter(processor, "MIDPEAKFREQ", 2000.0f + 1500.0f * (float) std::sin(blockIndex * 0.05));
+}
+
+void applySmoothingStep(Parametric_EQ_PluginAudioProcessor& processor, int smoothingStep)
+{
+	const auto* found = std::find(std::begin(smoothingSteps), std::end(smoothingSteps), smoothingStep);
+	jassert(found != std::end(smoothingSteps));
+	setParameter(processor, "SMOOTHSTEP", (float) (found - std::begin(smoothingSteps)));
+}
+
+//a FIR length of 0 runs the minimum phase cascade, anything else selects linear phase at that length
+bool configure(Parametric_EQ_PluginAudioProcessor& processor, double sampleRate, int blockSize, int numChannels, bool offline,
+			   int oversampling = 1, int firLength = 0, int precision = 0)
+{
+	const auto channelSet = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+	auto layout = processor.getBusesLayout();
+
+	layout.getChannelSet(true, 0) = channelSet;
+	layout.getChannelSet(false, 0) = channelSet;
+
+	if (! processor.setBusesLayout(layout))
+		return false;
+
+	setParameter(processor, "OVERSAMPLING", (float) juce::jmax(0, juce::roundToInt(std::log2(oversampling))));
+	setParameter(processor, "PHASEMODE", firLength > 0 ? 1.0f : 0.0f);
+	setParameter(processor, "FIRLENGTH", (float) juce::jlimit(0, 3, juce::roundToInt(std::log2(juce::jmax(1, firLength / 8192)))));
+	setParameter(processor, "PRECISION", precision == 1 ? 1.0f : 0.0f);
+	processor.setProcessingPrecision(precision == 2 ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision);
+	processor.setNonRealtime(offline);
+	processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+	processor.prepareToPlay(sampleRate, blockSize);
+	return true;
+}
+
+template <typename SampleType>
+void fillNoise(juce::AudioBuffer<SampleType>& buffer, juce::Random& random)
+{
+	for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+	{
+		auto* data = buffer.getWritePointer(ch);
+
+		for (int i = 0; i < buffer.getNumSamples(); ++i)
+			data[i] = (SampleType) (random.nextFloat() - 0.5f);
+	}
+}
+
+//==============================================================================
+template <typename SampleType>
+Result runScenario(const Scenario& scenario, const Options& options)
+{
+	Result result;
+	Parametric_EQ_PluginAudioProcessor processor;
+
+	if (! configure(processor, scenario.sampleRate, scenario.blockSize, scenario.numChannels, options.offline,
+					scenario.oversampling, scenario.firLength, scenario.precision))
+		return result;
+
+	applyActiveBands(processor, scenario.activeBands);
+	applyDynamicBands(processor, scenario.dynamicBands);
+	applySmoothingStep(processor, scenario.smoothingStep);
+	processor.getPerformanceMonitor().setEnabled(options.instrument);
+
+	juce::AudioBuffer<SampleType> buffer(processor.getTotalNumOutputChannels(), scenario.blockSize);
+	juce::MidiBuffer midi;
+	juce::Random random(0x5eed);
+
+	const auto numBlocks = juce::jmax(1, juce::roundToInt(options.seconds * scenario.sampleRate / scenario.blockSize));
+	const auto automationInterval = scenario.automationDensity > 0.0 ? juce::jmax(1, juce::roundToInt(1.0 / scenario.automationDensity)) : 0;
+
+	//let the first coefficient builds and crossfades settle before measuring
+	for (int i = 0; i < 8; ++i)
+	{
+		fillNoise(buffer, random);
+		processor.processBlock(buffer, midi);
+	}
+
+	juce::int64 totalNs = 0, worstNs = 0;
+	juce::uint64 totalCycles = 0;
+	const auto allocationsBefore = allocationCount.load();
+
+	for (int block = 0; block < numBlocks; ++block)
+	{
+		fillNoise(buffer, random);
+
+		if (automationInterval > 0 && block % automationInterval == 0)
+			automate(processor, block);
+
+		countAllocations = true;
+		const auto startCycles = readCycleCounter();
+		const auto start = std::chrono::steady_clock::now();
+
+		processor.processBlock(buffer, midi);
+
+		const auto end = std::chrono::steady_clock::now();
+		const auto endCycles = readCycleCounter();
+		countAllocations = false;
+
+		const auto ns = (juce::int64) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		totalNs += ns;
+		worstNs = juce::jmax(worstNs, ns);
+		totalCycles += endCycles - startCycles;
+	}
+
+	const auto totalSamples = (double) numBlocks * scenario.blockSize;
+
+	result.ok = true;
+	result.nsPerSample = (double) totalNs / totalSamples;
+	result.cyclesPerSample = (double) totalCycles / totalSamples;
+	result.worstBlockNs = (double) worstNs;
+	result.allocationsPerBlock = (double) (allocationCount.load() - allocationsBefore) / numBlocks;
+	return result;
+}
+
+Result runScenario(const Scenario& scenario, const Options& options)
+{
+	return scenario.precision == 2 ? runScenario<double>(scenario, options) : runScenario<float>(scenario, options);
+}
+
+void printResult(const Scenario& scenario, const Result& result, bool json)
+{
+	if (json)
+	{
+		std::cout << "{\"sampleRate\": " << scenario.sampleRate
+				  << ", \"blockSize\": " << scenario.blockSize
+				  << ", \"channels\": " << scenario.numChannels
+				  << ", \"activeBands\": " << scenario.activeBands
+				  << ", \"automationDensity\": " << scenario.automationDensity
+				  << ", \"oversampling\": " << scenario.oversampling
+				  << ", \"firLength\": " << scenario.firLength
+				  << ", \"precision\": \"" << precisionNames[scenario.precision] << "\""
+				  << ", \"dynamicBands\": " << scenario.dynamicBands
+				  << ", \"smoothingStep\": " << scenario.smoothingStep
+				  << ", \"ok\": " << (result.ok ? "true" : "false")
+				  << ", \"nsPerSample\": " << result.nsPerSample
+				  << ", \"cyclesPerSample\": " << result.cyclesPerSample
+				  << ", \"worstBlockNs\": " << result.worstBlockNs
+				  << ", \"allocationsPerBlock\": " << result.allocationsPerBlock << "}" << std::endl;
+		return;
+	}
+
+	juce::String line;
+	line << juce::String(scenario.sampleRate, 0).paddedLeft(' ', 7)
+		 << juce::String(scenario.blockSize).paddedLeft(' ', 6)
+		 << juce::String(scenario.numChannels).paddedLeft(' ', 4)
+		 << juce::String(scenario.activeBands).paddedLeft(' ', 6)
+		 << juce::String(scenario.automationDensity, 2).paddedLeft(' ', 7)
+		 << juce::String(scenario.oversampling).paddedLeft(' ', 4)
+		 << juce::String(scenario.firLength).paddedLeft(' ', 6)
+		 << juce::String(precisionNames[scenario.precision]).paddedLeft(' ', 7)
+		 << juce::String(scenario.dynamicBands).paddedLeft(' ', 4)
+		 << juce::String(scenario.smoothingStep).paddedLeft(' ', 5);
+
+	if (result.ok)
+		line << juce::String(result.nsPerSample, 2).paddedLeft(' ', 11)
+			 << juce::String(result.cyclesPerSample, 2).paddedLeft(' ', 14)
+			 << juce::String(result.worstBlockNs / 1000.0, 2).paddedLeft(' ', 13)
+			 << juce::String(result.allocationsPerBlock, 2).paddedLeft(' ', 14);
+	else
+		line << "  layout not supported";
+
+	std::cout << line << std::endl;
+}
+
+int runSweep(const Options& options)
+{
+	if (! options.json)
+		std::cout << "   rate block  ch bands  autom  os   fir   prec dyn  step  ns/sample cycles/sample worst_blk_us allocs/block" << std::endl;
+
+	auto allocatingScenarios = 0;
+
+	for (auto sampleRate : options.sampleRates)
+		for (auto blockSize : options.blockSizes)
+			for (auto numChannels : options.channelCounts)
+				for (auto activeBands : options.activeBands)
+					for (auto density : options.automationDensities)
+						for (auto oversampling : options.oversampling)
+							for (auto firLength : options.firLengths)
+								for (auto precision : options.precisions)
+									for (auto dynamicBands : options.dynamicBands)
+										for (auto smoothingStep : options.smoothingSteps)
+										{
+											const Scenario scenario { sampleRate, blockSize, numChannels, activeBands, density, oversampling, firLength, precision,
+																	  dynamicBands, smoothingStep };
+											const auto result = runScenario(scenario, options);
+											printResult(scenario, result, options.json);
+
+											if (result.ok && result.allocationsPerBlock > 0.0)
+												++allocatingScenarios;
+										}
+
+	//processBlock must never allocate once warmed up, any scenario where it did fails the run
+	if (allocatingScenarios > 0)
+	{
+		std::cerr << allocatingScenarios << " scenario(s) allocated in processBlock" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+//==============================================================================
+// Reference check: a fixed set of renders compared against a plain double precision biquad cascade built here
+// from the same band settings, so optimisations are checked against the filter maths rather than against saved output.
+struct ReferenceCase
+{
+	const char* name;
+	int numChannels;
+	int activeBands;
+};
+
+const ReferenceCase referenceCases[] = { { "flat", 2, 0 },
+										 { "two_bands", 2, 2 },
+										 { "all_bands", 2, 6 },
+										 { "surround_all_bands", 6, 6 },
+										 { "mono_all_bands", 1, 6 } };
+
+//every case runs at each of these rates and block sizes
+const double referenceSampleRates[] = { 44100.0, 48000.0, 96000.0 };
+const int referenceBlockSizes[] = { 64, 512 };
+constexpr double referenceSeconds = 2.0;
+
+int getReferenceNumBlocks(double sampleRate, int blockSize)
+{
+	return (int) std::ceil(sampleRate * referenceSeconds / blockSize);
+}
+
+juce::AudioBuffer<float> renderProcessor(const ReferenceCase& referenceCase, double sampleRate, int blockSize)
+{
+	Parametric_EQ_PluginAudioProcessor processor;
+	juce::AudioBuffer<float> output;
+
+	if (! configure(processor, sampleRate, blockSize, referenceCase.numChannels, false))
+		return output;
+
+	applyActiveBands(processor, referenceCase.activeBands);
+
+	const auto numBlocks = getReferenceNumBlocks(sampleRate, blockSize);
+	output.setSize(processor.getTotalNumOutputChannels(), blockSize * numBlocks);
+
+	juce::AudioBuffer<float> buffer(output.getNumChannels(), blockSize);
+	juce::MidiBuffer midi;
+	juce::Random random(1234);
+
+	for (int block = 0; block < numBlocks; ++block)
+	{
+		fillNoise(buffer, random);
+		processor.processBlock(buffer, midi);
+
+		for (int ch = 0; ch < output.getNumChannels(); ++ch)
+			output.copyFrom(ch, block * blockSize, buffer, ch, 0, blockSize);
+	}
+
+	return output;
+}
+
+std::vector<std::array<double, 6>> makeReferenceSections(const ChainSettings& settings, double sampleRate)
+{
+	using Coefficients = juce::dsp::IIR::ArrayCoefficients<double>;
+
+	std::vector<std::array<double, 6>> sections;
+	const auto gain = [](float decibels) { return juce::Decibels::decibelsToGain((double) decibels); };
+
+	const auto addCut = [&](bool highPass, float freq, Slope slope)
+	{
+		const auto order = 2 * ((int) slope + 1);
+
+		for (int i = 0; i < order / 2; ++i)
+		{
+			const auto q = CutFilterDesigns::getSectionQ(order, i);
+			sections.push_back(highPass ? Coefficients::makeHighPass(sampleRate, freq, q) : Coefficients::makeLowPass(sampleRate, freq, q));
+		}
+	};
+
+	//the same rules the processor uses to take bands out of the cascade
+	if (settings.lowCutFreq > CoefficientTables::minFreq)
+		addCut(true, settings.lowCutFreq, settings.lowCutSlope);
+
+	if (settings.lowShelfGainDB != 0.0f)
+		sections.push_back(Coefficients::makeLowShelf(sampleRate, settings.lowShelfFreq, settings.lowShelfQ, gain(settings.lowShelfGainDB)));
+
+	if (settings.lowMidGainDB != 0.0f)
+		sections.push_back(Coefficients::makePeakFilter(sampleRate, settings.lowMidFreq, settings.lowMidQ, gain(settings.lowMidGainDB)));
+
+	if (settings.midGainDB != 0.0f)
+		sections.push_back(Coefficients::makePeakFilter(sampleRate, settings.midFreq, settings.midQ, gain(settings.midGainDB)));
+
+	if (settings.hiShelfGainDB != 0.0f)
+		sections.push_back(Coefficients::makeHighShelf(sampleRate, settings.hiShelfFreq, settings.hiShelfQ, gain(settings.hiShelfGainDB)));
+
+	if (settings.hiCutFreq < CoefficientTables::maxFreq)
+		addCut(false, settings.hiCutFreq, settings.highCutSlope);
+
+	return sections;
+}
+
+//the same input run through the reference sections in transposed direct form II, one channel at a time
+juce::AudioBuffer<double> renderReference(const ReferenceCase& referenceCase, double sampleRate, int blockSize)
+{
+	Parametric_EQ_PluginAudioProcessor processor;
+	applyActiveBands(processor, referenceCase.activeBands);
+
+	auto sections = makeReferenceSections(getChainSettings(processor.apvts), sampleRate);
+
+	for (auto& c : sections)
+		for (auto& value : c)
+			value /= c[3];
+
+	//the noise is drawn block by block as renderProcessor draws it, so both get the same input
+	const auto numBlocks = getReferenceNumBlocks(sampleRate, blockSize);
+	juce::AudioBuffer<double> output(referenceCase.numChannels, blockSize * numBlocks);
+	juce::AudioBuffer<float> buffer(referenceCase.numChannels, blockSize);
+	juce::Random random(1234);
+
+	for (int block = 0; block < numBlocks; ++block)
+	{
+		fillNoise(buffer, random);
+
+		for (int ch = 0; ch < output.getNumChannels(); ++ch)
+			for (int i = 0; i < blockSize; ++i)
+				output.setSample(ch, block * blockSize + i, (double) buffer.getSample(ch, i));
+	}
+
+	for (int ch = 0; ch < output.getNumChannels(); ++ch)
+	{
+		auto* data = output.getWritePointer(ch);
+
+		for (const auto& c : sections)
+		{
+			auto s1 = 0.0, s2 = 0.0;
+
+			for (int i = 0; i < output.getNumSamples(); ++i)
+			{
+				const auto x = data[i];
+				const auto y = c[0] * x + s1;
+				s1 = c[1] * x - c[4] * y + s2;
+				s2 = c[2] * x - c[5] * y;
+				data[i] = y;
+			}
+		}
+	}
+
+	return output;
+}
+
+int runReference(const Options& options)
+{
+	auto failures = 0;
+
+	for (const auto sampleRate : referenceSampleRates)
+	{
+		//long enough for the parameter ramps after applyActiveBands and the filters' response to them to die away
+		const auto settleSamples = juce::roundToInt(sampleRate * 0.5);
+
+		for (const auto blockSize : referenceBlockSizes)
+		{
+			for (const auto& referenceCase : referenceCases)
+			{
+				const auto name = juce::String(referenceCase.name) + " @ " + juce::String(sampleRate) + " Hz / " + juce::String(blockSize);
+				const auto rendered = renderProcessor(referenceCase, sampleRate, blockSize);
+				const auto reference = renderReference(referenceCase, sampleRate, blockSize);
+
+				if (rendered.getNumChannels() != reference.getNumChannels() || rendered.getNumSamples() != reference.getNumSamples())
+				{
+					std::cout << name << ": FAIL (could not render)" << std::endl;
+					++failures;
+					continue;
+				}
+
+				auto maxError = 0.0;
+
+				for (int ch = 0; ch < reference.getNumChannels(); ++ch)
+					for (int i = settleSamples; i < reference.getNumSamples(); ++i)
+						maxError = juce::jmax(maxError, std::abs(reference.getSample(ch, i) - (double) rendered.getSample(ch, i)));
+
+				const auto ok = maxError <= options.tolerance;
+				std::cout << name << (ok ? ": ok" : ": FAIL") << " (max error " << maxError << ")" << std::endl;
+				failures += ok ? 0 : 1;
+			}
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Session load: how long a host takes to recall the same EQ state into many instances.
+double loadIntoAll(juce::OwnedArray<Parametric_EQ_PluginAudioProcessor>& instances, const juce::MemoryBlock& state)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (auto* instance : instances)
+		instance->setStateInformation(state.getData(), (int) state.getSize());
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int runSessionLoad(const Options& options)
+{
+	juce::MemoryBlock defaultState, binaryState, xmlState;
+
+	{
+		Parametric_EQ_PluginAudioProcessor source;
+		source.getStateInformation(defaultState);
+
+		applyActiveBands(source, 6);
+		source.getStateInformation(binaryState);
+
+		if (auto xml = source.apvts.copyState().createXml())
+			juce::AudioProcessor::copyXmlToBinary(*xml, xmlState);
+	}
+
+	juce::OwnedArray<Parametric_EQ_PluginAudioProcessor> instances;
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < options.sessionInstances; ++i)
+		instances.add(new Parametric_EQ_PluginAudioProcessor());
+
+	const auto constructMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	//each format is loaded over default settings, so both have every changed parameter to apply
+	loadIntoAll(instances, defaultState);
+	const auto binaryMs = loadIntoAll(instances, binaryState);
+
+	loadIntoAll(instances, defaultState);
+	const auto xmlMs = loadIntoAll(instances, xmlState);
+
+	if (options.json)
+	{
+		std::cout << "{\"instances\": " << options.sessionInstances
+				  << ", \"constructMs\": " << constructMs
+				  << ", \"binaryBytes\": " << binaryState.getSize()
+				  << ", \"binaryLoadMs\": " << binaryMs
+				  << ", \"xmlBytes\": " << xmlState.getSize()
+				  << ", \"xmlLoadMs\": " << xmlMs << "}" << std::endl;
+		return 0;
+	}
+
+	std::cout << "instances:   " << options.sessionInstances << "\n"
+			  << "construct:   " << constructMs << " ms\n"
+			  << "binary load: " << binaryMs << " ms (" << binaryState.getSize() << " bytes per state)\n"
+			  << "xml load:    " << xmlMs << " ms (" << xmlState.getSize() << " bytes per state)" << std::endl;
+	return 0;
+}
+
+//==============================================================================
+template <typename Type>
+juce::Array<Type> parseList(const juce::String& text)
+{
+	juce::Array<Type> values;
+
+	for (const auto& item : juce::StringArray::fromTokens(text, ",", {}))
+		values.add((Type) item.getDoubleValue());
+
+	return values;
+}
+
+juce::Array<int> parsePrecisions(const juce::String& text)
+{
+	juce::Array<int> values;
+
+	for (const auto& item : juce::StringArray::fromTokens(text, ",", {}))
+		for (int i = 0; i < (int) std::size(precisionNames); ++i)
+			if (item.trim() == precisionNames[i])
+				values.add(i);
+
+	return values;
+}
+
+juce::Array<int> parseSmoothingSteps(const juce::String& text)
+{
+	juce::Array<int> values;
+
+	for (auto step : parseList<int>(text))
+		if (std::find(std::begin(smoothingSteps), std::end(smoothingSteps), step) != std::end(smoothingSteps))
+			values.add(step);
+
+	return values;
+}
+
+void printUsage()
+{
+	std::cout << "Parametric_EQ_Benchmark [options]\n"
+				 "  --rates 44100,48000      sample rates to sweep\n"
+				 "  --blocks 16,512,4096     block sizes to sweep\n"
+				 "  --channels 1,2,6,12      channel counts to sweep\n"
+				 "  --bands 0,2,6            active band counts to sweep\n"
+				 "  --automation 0,0.1,1     fraction of blocks with a parameter change\n"
+				 "  --oversampling 1,2,4     oversampling factors to sweep\n"
+				 "  --linear-phase 0,65536   linear phase FIR lengths to sweep, 0 for minimum phase\n"
+				 "  --precision mixed,double precisions to sweep: single, mixed or double\n"
+				 "  --dynamic 0,1,4          dynamic band counts to sweep\n"
+				 "  --smoothing 0,32,1       coefficient rebuild steps of ramping bands to sweep, 0 for whole blocks\n"
+				 "  --seconds 1              audio rendered per scenario\n"
+				 "  --offline                run as a non-realtime render\n"
+				 "  --instrument             with the performance monitor on, to measure its overhead\n"
+				 "  --json                   one JSON object per scenario\n"
+				 "  --check-reference        compare against a double precision reference cascade, exit code 1 on mismatch\n"
+				 "  --tolerance 1e-3         max sample difference for --check-reference\n"
+				 "  --session-load 1000      time recalling a saved state into this many instances\n";
+}
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	Options options;
+	const juce::StringArray args(argv + 1, argc - 1);
+
+	for (int i = 0; i < args.size(); ++i)
+	{
+		const auto& arg = args[i];
+		const auto next = args[i + 1];
+
+		if (arg == "--rates")             { options.sampleRates = parseList<double>(next); ++i; }
+		else if (arg == "--blocks")       { options.blockSizes = parseList<int>(next); ++i; }
+		else if (arg == "--channels")     { options.channelCounts = parseList<int>(next); ++i; }
+		else if (arg == "--bands")        { options.activeBands = parseList<int>(next); ++i; }
+		else if (arg == "--automation")   { options.automationDensities = parseList<double>(next); ++i; }
+		else if (arg == "--oversampling") { options.oversampling = parseList<int>(next); ++i; }
+		else if (arg == "--linear-phase") { options.firLengths = parseList<int>(next); ++i; }
+		else if (arg == "--precision")    { options.precisions = parsePrecisions(next); ++i; }
+		else if (arg == "--dynamic")      { options.dynamicBands = parseList<int>(next); ++i; }
+		else if (arg == "--smoothing")    { options.smoothingSteps = parseSmoothingSteps(next); ++i; }
+		else if (arg == "--seconds")      { options.seconds = next.getDoubleValue(); ++i; }
+		else if (arg == "--tolerance")    { options.tolerance = next.getDoubleValue(); ++i; }
+		else if (arg == "--check-reference") { options.checkReference = true; }
+		else if (arg == "--session-load") { options.sessionInstances = next.getIntValue(); ++i; }
+		else if (arg == "--offline")      { options.offline = true; }
+		else if (arg == "--instrument")   { options.instrument = true; }
+		else if (arg == "--json")         { options.json = true; }
+		else
+		{
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	if (options.sessionInstances > 0)
+		return runSessionLoad(options);
+
+	if (options.checkReference)
+		return runReference(options);
+
+	return runSweep(options);
+}
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    Small persistent worker pool for splitting offline renders across channels.
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+
+//==============================================================================
+ChannelWorkerPool::Worker::Worker(ChannelWorkerPool& owner)
+	: juce::Thread("EQ Channel Worker"), pool(owner)
+{
+}
+
+void ChannelWorkerPool::Worker::run()
+{
+	while (! threadShouldExit())
+	{
+		wait(-1);
+
+		if (threadShouldExit())
+			break;
+
+		pool.runPendingTasks();
+	}
+}
+
+//==============================================================================
+ChannelWorkerPool::ChannelWorkerPool(int numWorkers)
+{
+	for (int i = 0; i < numWorkers; ++i)
+		workers.add(new Worker(*this))->startThread();
+}
+
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+	for (auto* worker : workers)
+	{
+		worker->signalThreadShouldExit();
+		worker->notify();
+	}
+
+	for (auto* worker : workers)
+		worker->stopThread(1000);
+}
+
+void ChannelWorkerPool::run(Job& job, int numTasks)
+{
+	if (numTasks <= 0)
+		return;
+
+	{
+		const juce::ScopedLock sl(lock);
+		currentJob = &job;
+		nextTask = 0;
+		totalTasks = numTasks;
+		tasksLeft = numTasks;
+	}
+
+	//the calling thread takes one of the tasks too, so only wake as many workers as there is work for
+	for (int i = 0; i < juce::jmin(workers.size(), numTasks - 1); ++i)
+		workers.getUnchecked(i)->notify();
+
+	runPendingTasks();
+
+	for (;;)
+	{
+		{
+			const juce::ScopedLock sl(lock);
+
+			if (tasksLeft == 0)
+				break;
+		}
+
+		allTasksDone.wait(-1);
+	}
+}
+
+void ChannelWorkerPool::runPendingTasks()
+{
+	for (;;)
+	{
+		Job* job = nullptr;
+		int taskIndex = 0;
+
+		{
+			const juce::ScopedLock sl(lock);
+
+			if (nextTask >= totalTasks)
+				return;
+
+			job = currentJob;
+			taskIndex = nextTask++;
+		}
+
+		job->runTask(taskIndex);
+
+		const juce::ScopedLock sl(lock);
+
+		if (--tasksLeft == 0)
+			allTasksDone.signal();
+	}
+}
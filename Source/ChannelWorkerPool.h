@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Small persistent worker pool for splitting offline renders across channels.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+	A fixed set of worker threads that are created once and then woken for each
+	block. run() hands out task indices to the workers and the calling thread, and
+	returns once every task has finished.
+
+	Hand-off uses a lock and events, so this is meant for non-realtime rendering
+	only, never for the realtime audio thread.
+*/
+class ChannelWorkerPool
+{
+public:
+	struct Job
+	{
+		virtual ~Job() = default;
+		virtual void runTask(int taskIndex) = 0;
+	};
+
+	explicit ChannelWorkerPool(int numWorkers);
+	~ChannelWorkerPool();
+
+	int getNumWorkers() const noexcept { return workers.size(); }
+
+	/** Calls job.runTask(i) for every i in [0, numTasks), spread over the workers and the calling thread. */
+	void run(Job& job, int numTasks);
+
+private:
+	class Worker : public juce::Thread
+	{
+	public:
+		explicit Worker(ChannelWorkerPool& owner);
+		void run() override;
+
+	private:
+		ChannelWorkerPool& pool;
+	};
+
+	void runPendingTasks();
+
+	juce::CriticalSection lock;
+	Job* currentJob = nullptr;
+	int nextTask = 0, totalTasks = 0, tasksLeft = 0;
+	juce::WaitableEvent allTasksDone;
+
+	juce::OwnedArray<Worker> workers;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelWorkerPool)
+};
@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    Lookup tables for building band coefficients without transcendental math.
+
+  ==============================================================================
+*/
+
+#include "CoefficientTables.h"
+
+//==============================================================================
+CoefficientTables::CoefficientTables(double rate)
+	: sampleRate(rate)
+{
+#if EQ_USE_COEFFICIENT_TABLES
+	const auto numFreqs = (size_t) (maxFreq - minFreq) + 1;
+
+	cosTable.resize(numFreqs);
+	sinTable.resize(numFreqs);
+
+	for (size_t i = 0; i < numFreqs; ++i)
+	{
+		const auto omega = juce::MathConstants<double>::twoPi * (minFreq + (double) i) / sampleRate;
+		cosTable[i] = (float) std::cos(omega);
+		sinTable[i] = (float) std::sin(omega);
+	}
+
+	const auto numGains = (size_t) ((maxGainDB - minGainDB) / gainStepDB) * gainSubdivisions + 1;
+
+	ampTable.resize(numGains);
+	sqrtAmpTable.resize(numGains);
+
+	for (size_t i = 0; i < numGains; ++i)
+	{
+		const auto gainDB = minGainDB + gainStepDB * (double) i / gainSubdivisions;
+		ampTable[i] = (float) std::pow(10.0, gainDB / 40.0);
+		sqrtAmpTable[i] = (float) std::pow(10.0, gainDB / 80.0);
+	}
+#endif
+}
+
+CoefficientTables::Trig CoefficientTables::lookupTrig(float freq) const noexcept
+{
+	const auto position = juce::jlimit(0.0f, maxFreq - minFreq, freq - minFreq);
+	const auto index = juce::jmin((size_t) position, cosTable.size() - 2);
+	const auto frac = position - (float) index;
+
+	return { cosTable[index] + frac * (cosTable[index + 1] - cosTable[index]),
+			 sinTable[index] + frac * (sinTable[index + 1] - sinTable[index]) };
+}
+
+CoefficientTables::Amplitude CoefficientTables::lookupAmplitude(float gainDB) const noexcept
+{
+	const auto position = juce::jlimit(0.0f, maxGainDB - minGainDB, gainDB - minGainDB) * (gainSubdivisions / gainStepDB);
+	const auto index = juce::jmin((size_t) position, ampTable.size() - 2);
+	const auto frac = position - (float) index;
+
+	return { ampTable[index] + frac * (ampTable[index + 1] - ampTable[index]),
+			 sqrtAmpTable[index] + frac * (sqrtAmpTable[index + 1] - sqrtAmpTable[index]) };
+}
+
+std::array<float, 6> CoefficientTables::makePeakFilter(float freq, float q, float gainDB) const noexcept
+{
+#if EQ_USE_COEFFICIENT_TABLES
+	const auto trig = lookupTrig(freq);
+	const auto amp = lookupAmplitude(gainDB);
+
+	const auto alpha = trig.sin / (q * 2.0f);
+	const auto c2 = -2.0f * trig.cos;
+	const auto alphaTimesA = alpha * amp.a;
+	const auto alphaOverA = alpha / amp.a;
+
+	return { 1.0f + alphaTimesA, c2, 1.0f - alphaTimesA, 1.0f + alphaOverA, c2, 1.0f - alphaOverA };
+#else
+	return juce::dsp::IIR::ArrayCoefficients<float>::makePeakFilter(sampleRate, freq, q, juce::Decibels::decibelsToGain(gainDB));
+#endif
+}
+
+std::array<float, 6> CoefficientTables::makeLowShelf(float freq, float q, float gainDB) const noexcept
+{
+#if EQ_USE_COEFFICIENT_TABLES
+	const auto trig = lookupTrig(freq);
+	const auto amp = lookupAmplitude(gainDB);
+
+	const auto aMinus1 = amp.a - 1.0f;
+	const auto aPlus1 = amp.a + 1.0f;
+	const auto beta = trig.sin * amp.sqrtA / q;
+	const auto aMinus1TimesCos = aMinus1 * trig.cos;
+
+	return { amp.a * (aPlus1 - aMinus1TimesCos + beta),
+			 amp.a * 2.0f * (aMinus1 - aPlus1 * trig.cos),
+			 amp.a * (aPlus1 - aMinus1TimesCos - beta),
+			 aPlus1 + aMinus1TimesCos + beta,
+			 -2.0f * (aMinus1 + aPlus1 * trig.cos),
+			 aPlus1 + aMinus1TimesCos - beta };
+#else
+	return juce::dsp::IIR::ArrayCoefficients<float>::makeLowShelf(sampleRate, freq, q, juce::Decibels::decibelsToGain(gainDB));
+#endif
+}
+
+std::array<float, 6> CoefficientTables::makeHighShelf(float freq, float q, float gainDB) const noexcept
+{
+#if EQ_USE_COEFFICIENT_TABLES
+	const auto trig = lookupTrig(freq);
+	const auto amp = lookupAmplitude(gainDB);
+
+	const auto aMinus1 = amp.a - 1.0f;
+	const auto aPlus1 = amp.a + 1.0f;
+	const auto beta = trig.sin * amp.sqrtA / q;
+	const auto aMinus1TimesCos = aMinus1 * trig.cos;
+
+	return { amp.a * (aPlus1 + aMinus1TimesCos + beta),
+			 amp.a * -2.0f * (aMinus1 + aPlus1 * trig.cos),
+			 amp.a * (aPlus1 + aMinus1TimesCos - beta),
+			 aPlus1 - aMinus1TimesCos + beta,
+			 2.0f * (aMinus1 - aPlus1 * trig.cos),
+			 aPlus1 - aMinus1TimesCos - beta };
+#else
+	return juce::dsp::IIR::ArrayCoefficients<float>::makeHighShelf(sampleRate, freq, q, juce::Decibels::decibelsToGain(gainDB));
+#endif
+}
+
+std::array<float, 6> CoefficientTables::makeHighPass(float freq, float q) const noexcept
+{
+#if EQ_USE_COEFFICIENT_TABLES
+	//tan(omega / 2) from the tabulated cos and sin
+	const auto trig = lookupTrig(freq);
+	const auto n = trig.sin / (1.0f + trig.cos);
+	const auto nSquared = n * n;
+	const auto invQ = 1.0f / q;
+	const auto c1 = 1.0f / (1.0f + invQ * n + nSquared);
+
+	return { c1, c1 * -2.0f, c1, 1.0f, c1 * 2.0f * (nSquared - 1.0f), c1 * (1.0f - invQ * n + nSquared) };
+#else
+	return juce::dsp::IIR::ArrayCoefficients<float>::makeHighPass(sampleRate, freq, q);
+#endif
+}
+
+std::array<float, 6> CoefficientTables::makeLowPass(float freq, float q) const noexcept
+{
+#if EQ_USE_COEFFICIENT_TABLES
+	//1 / tan(omega / 2) from the tabulated cos and sin
+	const auto trig = lookupTrig(freq);
+	const auto n = (1.0f + trig.cos) / trig.sin;
+	const auto nSquared = n * n;
+	const auto invQ = 1.0f / q;
+	const auto c1 = 1.0f / (1.0f + invQ * n + nSquared);
+
+	return { c1, c1 * 2.0f, c1, 1.0f, c1 * 2.0f * (1.0f - nSquared), c1 * (1.0f - invQ * n + nSquared) };
+#else
+	return juce::dsp::IIR::ArrayCoefficients<float>::makeLowPass(sampleRate, freq, q);
+#endif
+}
+
+//==============================================================================
+std::shared_ptr<const CoefficientTables> CoefficientTableCache::getTables(double sampleRate)
+{
+	const juce::ScopedLock sl(lock);
+
+	//rates no instance holds any more are dropped while we're here
+	for (auto it = tables.begin(); it != tables.end();)
+		it = it->second.expired() ? tables.erase(it) : std::next(it);
+
+	auto& entry = tables[sampleRate];
+	auto existing = entry.lock();
+
+	if (existing == nullptr)
+	{
+		existing = std::make_shared<const CoefficientTables>(sampleRate);
+		entry = existing;
+	}
+
+	return existing;
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Lookup tables for building band coefficients without transcendental math.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//set to 0 to build every coefficient with juce::dsp::IIR::ArrayCoefficients instead
+#ifndef EQ_USE_COEFFICIENT_TABLES
+#define EQ_USE_COEFFICIENT_TABLES 1
+#endif
+
+//==============================================================================
+/**
+	Holds cos/sin of the band frequency on the 1 Hz grid of the frequency
+	parameters, and the shelf/peak amplitude terms on (a subdivision of) the 0.5 dB
+	grid of the gain parameters, for one sample rate. Building a band's coefficients from these is a
+	couple of lookups, a linear interpolation and a handful of multiplies, which is
+	what makes rebuilding them every smoothing step cheap.
+
+	The results match the designs in IIR::ArrayCoefficients and are returned in
+	the same unnormalised { b0, b1, b2, a0, a1, a2 } layout.
+
+	Instances are immutable once built and are shared between every plugin instance
+	running at the same rate, see CoefficientTableCache.
+*/
+class CoefficientTables
+{
+public:
+	static constexpr float minFreq = 20.0f;
+	static constexpr float maxFreq = 20000.0f;
+	static constexpr float minGainDB = -24.0f;
+	static constexpr float maxGainDB = 24.0f;
+	static constexpr float gainStepDB = 0.5f;
+
+	//gain entries are stored at a finer spacing than the parameter grid so ramps between grid points interpolate accurately
+	static constexpr int gainSubdivisions = 8;
+
+	explicit CoefficientTables(double sampleRate);
+
+	double getSampleRate() const noexcept { return sampleRate; }
+
+	std::array<float, 6> makePeakFilter(float freq, float q, float gainDB) const noexcept;
+	std::array<float, 6> makeLowShelf(float freq, float q, float gainDB) const noexcept;
+	std::array<float, 6> makeHighShelf(float freq, float q, float gainDB) const noexcept;
+	std::array<float, 6> makeHighPass(float freq, float q) const noexcept;
+	std::array<float, 6> makeLowPass(float freq, float q) const noexcept;
+
+private:
+	struct Trig
+	{
+		float cos, sin;
+	};
+
+	struct Amplitude
+	{
+		float a, sqrtA;
+	};
+
+	Trig lookupTrig(float freq) const noexcept;
+	Amplitude lookupAmplitude(float gainDB) const noexcept;
+
+	double sampleRate;
+	std::vector<float> cosTable, sinTable;
+	std::vector<float> ampTable, sqrtAmpTable;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CoefficientTables)
+};
+
+//==============================================================================
+/**
+	Process-wide cache of CoefficientTables, one per sample rate, built lazily.
+
+	Use it through a juce::SharedResourcePointer. Tables stay alive for as long as
+	some instance holds on to them. getTables() locks and may allocate, so call it
+	from prepareToPlay and never from the audio thread.
+*/
+class CoefficientTableCache
+{
+public:
+	std::shared_ptr<const CoefficientTables> getTables(double sampleRate);
+
+private:
+	juce::CriticalSection lock;
+	std::map<double, std::weak_ptr<const CoefficientTables>> tables;
+};
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    Cached Butterworth designs for the Low Cut and Hi Cut filters.
+
+  ==============================================================================
+*/
+
+#include "CutFilterDesigns.h"
+
+//==============================================================================
+void CutFilterDesigns::prepare(std::shared_ptr<const CoefficientTables> tablesToUse)
+{
+	tables = std::move(tablesToUse);
+
+	if (tables->getSampleRate() != sampleRate)
+	{
+		sampleRate = tables->getSampleRate();
+
+		for (auto& entry : entries)
+			entry.valid = false;
+	}
+}
+
+void CutFilterDesigns::release() noexcept
+{
+	tables.reset();
+	sampleRate = 0;
+
+	for (auto& entry : entries)
+		entry.valid = false;
+}
+
+const CutFilterDesigns::Design& CutFilterDesigns::getDesign(Type type, float freq, int order) noexcept
+{
+	jassert(order >= 2 && order <= 2 * maxSections && order % 2 == 0);
+
+	//frequencies sit on a 1 Hz grid, so the integer part spreads neighbouring settings over different slots
+	const auto slot = ((size_t) freq * 4 + (size_t) (order / 2 - 1) + (type == Type::LowPass ? numEntries / 2 : 0)) % numEntries;
+	auto& entry = entries[slot];
+
+	if (! entry.valid || entry.type != type || entry.freq != freq || entry.order != order)
+	{
+		design(entry.design, type, freq, order);
+		entry.type = type;
+		entry.freq = freq;
+		entry.order = order;
+		entry.valid = true;
+	}
+
+	return entry.design;
+}
+
+void CutFilterDesigns::design(Design& result, Type type, float freq, int order) const noexcept
+{
+	//keep the corner safely below Nyquist, at low sample rates the top of the parameter range is out of reach
+	const auto corner = juce::jmin(freq, (float) (sampleRate * 0.49));
+
+	result.numSections = order / 2;
+
+	for (int i = 0; i < result.numSections; ++i)
+	{
+		const auto q = (float) getSectionQ(order, i);
+
+		result.sections[(size_t) i] = type == Type::HighPass ? tables->makeHighPass(corner, q)
+															 : tables->makeLowPass(corner, q);
+	}
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    Cached Butterworth designs for the Low Cut and Hi Cut filters.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientTables.h"
+
+//==============================================================================
+/**
+	High order Butterworth high pass and low pass designs, split into biquad
+	sections the same way as FilterDesign::designIIRHighpassHighOrderButterworthMethod,
+	but built without allocating and kept in a small fixed-size cache keyed on
+	(type, frequency, order, sample rate). Flipping back and forth between settings,
+	as automation does, reuses the stored sections instead of designing them again.
+
+	The cache is a plain direct-mapped table owned by one processor, so lookups
+	are safe on the audio thread.
+*/
+class CutFilterDesigns
+{
+public:
+	enum class Type
+	{
+		HighPass,
+		LowPass
+	};
+
+	static constexpr int maxSections = 4;
+
+	struct Design
+	{
+		int numSections = 0;
+		std::array<std::array<float, 6>, maxSections> sections {};
+	};
+
+	CutFilterDesigns() = default;
+
+	/** Points the cache at the tables for a sample rate, dropping every entry if the rate has changed. */
+	void prepare(std::shared_ptr<const CoefficientTables> tablesToUse);
+
+	/** Lets go of the tables and forgets every design. Call prepare() again before using it. */
+	void release() noexcept;
+
+	/** Returns the sections for an even Butterworth order of 2 to 8. */
+	const Design& getDesign(Type type, float freq, int order) noexcept;
+
+	/** Q of one biquad section of an even order Butterworth filter. */
+	static double getSectionQ(int order, int section) noexcept
+	{
+		return 1.0 / (2.0 * std::cos((2.0 * section + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+	}
+
+private:
+	struct Entry
+	{
+		bool valid = false;
+		Type type = Type::HighPass;
+		float freq = 0;
+		int order = 0;
+		Design design;
+	};
+
+	static constexpr size_t numEntries = 64;
+
+	void design(Design& result, Type type, float freq, int order) const noexcept;
+
+	std::shared_ptr<const CoefficientTables> tables;
+	double sampleRate = 0;
+	std::array<Entry, numEntries> entries;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CutFilterDesigns)
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Band-limited level detectors for the dynamic bands, one per SIMD lane.
+
+  ==============================================================================
+*/
+
+#include "DynamicDetector.h"
+
+//==============================================================================
+void DynamicDetector::prepare(double newSampleRate) noexcept
+{
+	sampleRate = newSampleRate;
+	tunedFreq.fill(0.0f);
+	tunedQ.fill(0.0f);
+
+	for (int band = 0; band < numBands; ++band)
+		setBand(band, 1000.0f, 1.0f);
+
+	reset();
+}
+
+void DynamicDetector::reset() noexcept
+{
+	s1.fill(Lanes(0.0f));
+	s2.fill(Lanes(0.0f));
+	envelope.fill(Lanes(0.0f));
+}
+
+void DynamicDetector::setTimes(float attackMs, float releaseMs) noexcept
+{
+	//one pole smoothing coefficients, reaching 1 - 1/e of a step in the given time
+	const auto coefficient = [this](float ms) { return 1.0f - std::exp(-1000.0f / (juce::jmax(0.01f, ms) * (float) sampleRate)); };
+
+	attack = Lanes(coefficient(attackMs));
+	release = Lanes(coefficient(juce::jmax(attackMs, releaseMs)));
+}
+
+void DynamicDetector::setBand(int band, float freq, float q) noexcept
+{
+	jassert(juce::isPositiveAndBelow(band, numBands));
+
+	if (freq == tunedFreq[(size_t) band] && q == tunedQ[(size_t) band])
+		return;
+
+	tunedFreq[(size_t) band] = freq;
+	tunedQ[(size_t) band] = q;
+
+	const auto c = juce::dsp::IIR::ArrayCoefficients<float>::makeBandPass(sampleRate, juce::jmin(freq, (float) (sampleRate * 0.49)), q);
+	const auto a0Inv = 1.0f / c[3];
+	const auto group = band / numLanes;
+	const auto lane = band % numLanes;
+
+	setLane(b0[(size_t) group], lane, c[0] * a0Inv);
+	setLane(a1[(size_t) group], lane, c[4] * a0Inv);
+	setLane(a2[(size_t) group], lane, c[5] * a0Inv);
+}
+
+void DynamicDetector::process(const float* key, int numSamples) noexcept
+{
+	for (int group = 0; group < numGroups; ++group)
+	{
+		//everything the loop touches is held in registers for the whole run
+		const auto gb0 = b0[(size_t) group], ga1 = a1[(size_t) group], ga2 = a2[(size_t) group];
+		auto z1 = s1[(size_t) group], z2 = s2[(size_t) group], env = envelope[(size_t) group];
+
+		for (int i = 0; i < numSamples; ++i)
+		{
+			const auto x = gb0 * Lanes(key[i]);
+			const auto y = x + z1;
+
+			z1 = z2 - ga1 * y;
+			z2 = Lanes(0.0f) - x - ga2 * y;
+
+			//with attack at least as fast as release, the larger step is attack going up and release going down
+			const auto delta = y * y - env;
+			env = env + maxOf(attack * delta, release * delta);
+		}
+
+		s1[(size_t) group] = z1;
+		s2[(size_t) group] = z2;
+		envelope[(size_t) group] = env;
+	}
+}
+
+float DynamicDetector::getLevelDecibels(int band) const noexcept
+{
+	//a sine's mean power is half its peak squared, doubling it puts a full scale sine at 0 dB rather than -3 dB
+	const auto power = 2.0f * getLane(envelope[(size_t) (band / numLanes)], band % numLanes);
+	return juce::jmax(minDecibels, 10.0f * std::log10(power + 1.0e-20f));
+}
+
+//==============================================================================
+void DynamicDetector::setLane(Lanes& target, int lane, float value) noexcept
+{
+#if JUCE_USE_SIMD
+	target.set((size_t) lane, value);
+#else
+	juce::ignoreUnused(lane);
+	target = value;
+#endif
+}
+
+float DynamicDetector::getLane(const Lanes& source, int lane) noexcept
+{
+#if JUCE_USE_SIMD
+	return source.get((size_t) lane);
+#else
+	juce::ignoreUnused(lane);
+	return source;
+#endif
+}
+
+DynamicDetector::Lanes DynamicDetector::maxOf(Lanes a, Lanes b) noexcept
+{
+#if JUCE_USE_SIMD
+	return Lanes::max(a, b);
+#else
+	return juce::jmax(a, b);
+#endif
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    Band-limited level detectors for the dynamic bands, one per SIMD lane.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+	Measures the level of a mono key signal around each dynamic band's frequency.
+	Every band has a band-pass with 0 dB peak gain tuned to the band, followed by an
+	envelope of its power with separate attack and release. The bands sit in the
+	lanes of a SIMD register, so all four are detected in one pass over the key,
+	for roughly the cost of a single biquad.
+
+	The detector only measures. The processor reads the levels back once per
+	control step and turns them into gain for the EQ bands themselves.
+*/
+class DynamicDetector
+{
+public:
+#if JUCE_USE_SIMD
+	using Lanes = juce::dsp::SIMDRegister<float>;
+	static constexpr int numLanes = (int) Lanes::SIMDNumElements;
+#else
+	using Lanes = float;
+	static constexpr int numLanes = 1;
+#endif
+
+	static constexpr int numBands = 4;
+	static constexpr float minDecibels = -120.0f;
+
+	DynamicDetector() = default;
+
+	void prepare(double newSampleRate) noexcept;
+	void reset() noexcept;
+
+	/** The envelope times shared by every band. Release is never shorter than attack. */
+	void setTimes(float attackMs, float releaseMs) noexcept;
+
+	/** Tunes a band's band-pass, only recalculating when the frequency or Q moved. */
+	void setBand(int band, float freq, float q) noexcept;
+
+	/** Runs every band over the key signal. */
+	void process(const float* key, int numSamples) noexcept;
+
+	/** The band's envelope in dB, read as a sine's peak level, so a full scale sine at the band's frequency is 0 dB. */
+	float getLevelDecibels(int band) const noexcept;
+
+private:
+	static constexpr int numGroups = (numBands + numLanes - 1) / numLanes;
+
+	static void setLane(Lanes& target, int lane, float value) noexcept;
+	static float getLane(const Lanes& source, int lane) noexcept;
+	static Lanes maxOf(Lanes a, Lanes b) noexcept;
+
+	double sampleRate = 44100.0;
+
+	//band-pass b1 is always zero and b2 always -b0, so three coefficients describe it
+	std::array<Lanes, numGroups> b0 {}, a1 {}, a2 {};
+	std::array<Lanes, numGroups> s1 {}, s2 {}, envelope {};
+	Lanes attack { 1.0f }, release { 1.0f };
+
+	std::array<float, numBands> tunedFreq {}, tunedQ {};
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DynamicDetector)
+};
@@ -0,0 +1,505 @@
+/*
+  ==============================================================================
+
+    Fused biquad cascade that runs several channels at once, one channel per
+    lane of a SIMD register.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChannelWorkerPool.h"
+
+//==============================================================================
+/**
+	Runs every band of the EQ in a single pass over the block. Each channel sits
+	in its own lane of a SIMD register, so channels are computed together in groups
+	of the register width, whatever the bus layout. Coefficients can be set for all
+	channels at once (linked) or for a single channel.
+
+	Stages are transposed direct form II biquads kept in chain order. Disabled
+	stages are left out of the per-sample loop. When the set of enabled stages
+	changes, the next blocks crossfade from the old cascade to the new one so a
+	band can drop in or out without a click.
+
+	All coefficients and filter state live in one aligned arena, laid out as
+	structure-of-arrays planes and sized in prepare(). The state planes are a
+	single contiguous run, so the whole cascade state can be copied in one go.
+
+	Channel groups never share state, so a block can also be split across a
+	ChannelWorkerPool, one group per task, with bit-identical results.
+
+	In mid/side mode the first two channels are encoded to mid and side as they
+	are loaded into the lanes and decoded again as they are stored, so the matrix
+	costs a few adds in the same pass rather than passes of its own. Without SIMD
+	every channel is a group of its own, so the pair is encoded in place around
+	their two groups instead, which then always run together on one thread.
+
+	SampleType sets the precision of the coefficients, state and arithmetic. The
+	audio passed to process() may be of either type, so a double precision cascade
+	can also run on float buffers.
+*/
+template <typename SampleType>
+class EQCascade
+{
+public:
+#if JUCE_USE_SIMD
+	using Lanes = juce::dsp::SIMDRegister<SampleType>;
+	static constexpr int numLanes = (int) Lanes::SIMDNumElements;
+#else
+	using Lanes = SampleType;
+	static constexpr int numLanes = 1;
+#endif
+
+	static constexpr int maxStages = 12;
+	static constexpr double fadeTimeSeconds = 0.005;
+
+	EQCascade()
+	{
+		stageEnabled.fill(false);
+	}
+
+	/** Sizes the arena and crossfade buffer. Coefficients are reset to identity and the state to silence. */
+	void prepare(const juce::dsp::ProcessSpec& spec)
+	{
+		numChannels = (int) spec.numChannels;
+		numGroups = (numChannels + numLanes - 1) / numLanes;
+
+		const auto stateSize = (size_t) (numGroups * numStatePlanes * maxStages);
+		const auto numElements = (size_t) (numGroups * numCoeffPlanes * maxStages) + 2 * stateSize;
+
+		arenaMemory.allocate(numElements * sizeof(Lanes) + alignof(Lanes), true);
+		coeffs = juce::snapPointerToAlignment(reinterpret_cast<Lanes*>(arenaMemory.getData()), alignof(Lanes));
+		state = coeffs + numGroups * numCoeffPlanes * maxStages;
+		fadeState = state + stateSize;
+
+		fadeBuffer.setSize(numChannels, (int) spec.maximumBlockSize);
+		fadeLength = juce::jmax(1, juce::roundToInt(spec.sampleRate * fadeTimeSeconds));
+
+		for (int group = 0; group < numGroups; ++group)
+			for (int i = 0; i < maxStages; ++i)
+				setGroupCoefficients(group, i, 1, 0, 0, 0, 0);
+
+		reset();
+	}
+
+	/** Frees the coefficient, state and crossfade memory. Call prepare() again before processing. */
+	void release()
+	{
+		arenaMemory.free();
+		coeffs = state = fadeState = nullptr;
+		numChannels = numGroups = 0;
+		fadeBuffer.setSize(0, 0);
+		reset();
+	}
+
+	/** Clears the filter state of every stage and drops any crossfade in progress. */
+	void reset() noexcept
+	{
+		std::fill(state, state + getStateSize(), Lanes(0));
+		fadeRemaining = 0;
+		pendingFade = false;
+	}
+
+	/** Number of Lanes values in the contiguous state planes. */
+	size_t getStateSize() const noexcept { return (size_t) (numGroups * numStatePlanes * maxStages); }
+
+	void copyStateTo(Lanes* dest) const noexcept { std::copy(state, state + getStateSize(), dest); }
+	void copyStateFrom(const Lanes* source) noexcept { std::copy(source, source + getStateSize(), state); }
+
+	int getNumChannels() const noexcept { return numChannels; }
+	int getNumGroups() const noexcept { return numGroups; }
+
+	/** Sets a stage on every channel from unnormalised { b0, b1, b2, a0, a1, a2 }, as returned by IIR::ArrayCoefficients. */
+	template <typename CoefficientType>
+	void setCoefficients(int stageIndex, const std::array<CoefficientType, 6>& c) noexcept
+	{
+		jassert(juce::isPositiveAndBelow(stageIndex, maxStages));
+
+		const auto a0Inv = SampleType(1) / (SampleType) c[3];
+
+		for (int group = 0; group < numGroups; ++group)
+			setGroupCoefficients(group, stageIndex, c[0] * a0Inv, c[1] * a0Inv, c[2] * a0Inv, c[4] * a0Inv, c[5] * a0Inv);
+	}
+
+	/** Sets a stage on a single channel, leaving the other lanes of its group alone. */
+	template <typename CoefficientType>
+	void setCoefficients(int stageIndex, int channel, const std::array<CoefficientType, 6>& c) noexcept
+	{
+		jassert(juce::isPositiveAndBelow(stageIndex, maxStages));
+		jassert(juce::isPositiveAndBelow(channel, numChannels));
+
+		const auto a0Inv = SampleType(1) / (SampleType) c[3];
+		const auto group = channel / numLanes;
+		const auto lane = channel % numLanes;
+
+		setLane(coeffAt(group, B0, stageIndex), lane, c[0] * a0Inv);
+		setLane(coeffAt(group, B1, stageIndex), lane, c[1] * a0Inv);
+		setLane(coeffAt(group, B2, stageIndex), lane, c[2] * a0Inv);
+		setLane(coeffAt(group, A1, stageIndex), lane, c[4] * a0Inv);
+		setLane(coeffAt(group, A2, stageIndex), lane, c[5] * a0Inv);
+	}
+
+	/**
+		Adds or removes a stage from the per-sample loop. A stage that is switched back
+		on starts from silence, and the next process() call crossfades from the cascade
+		as it was before the first change since the previous block.
+	*/
+	void setStageEnabled(int stageIndex, bool shouldBeEnabled) noexcept
+	{
+		jassert(juce::isPositiveAndBelow(stageIndex, maxStages));
+
+		if (stageEnabled[(size_t) stageIndex] == shouldBeEnabled)
+			return;
+
+		beginChange();
+		stageEnabled[(size_t) stageIndex] = shouldBeEnabled;
+
+		if (shouldBeEnabled)
+			for (int group = 0; group < numGroups; ++group)
+				for (int plane = 0; plane < numStatePlanes; ++plane)
+					stateAt(state, group, plane, stageIndex) = Lanes(0);
+
+		numActiveStages = 0;
+
+		for (int i = 0; i < maxStages; ++i)
+			if (stageEnabled[(size_t) i])
+				activeStages[(size_t) numActiveStages++] = i;
+	}
+
+	bool isStageEnabled(int stageIndex) const noexcept { return stageEnabled[(size_t) stageIndex]; }
+
+	/**
+		Switches mid/side processing of the first two channels on or off. Their filter
+		state no longer matches the signal, so it starts from silence and the next
+		process() call crossfades from the cascade in its previous mode.
+	*/
+	void setMidSide(bool shouldUseMidSide) noexcept
+	{
+		if (midSide == shouldUseMidSide)
+			return;
+
+		beginChange();
+		midSide = shouldUseMidSide;
+		std::fill(state, state + getStateSize(), Lanes(0));
+	}
+
+	bool isMidSide() const noexcept { return midSide; }
+
+	/** Filters the block in place. Channels beyond the prepared count are left untouched. */
+	template <typename IOType>
+	void process(const juce::dsp::AudioBlock<IOType>& block) noexcept
+	{
+		const auto numFadeSamples = beginBlock((int) block.getNumSamples());
+		processGroups(block, 0, numGroups, numFadeSamples);
+		fadeRemaining -= numFadeSamples;
+	}
+
+	/** As process(), with each channel group handed to the pool as a separate task. */
+	template <typename IOType>
+	void process(const juce::dsp::AudioBlock<IOType>& block, ChannelWorkerPool& pool)
+	{
+		struct GroupJob : ChannelWorkerPool::Job
+		{
+			GroupJob(EQCascade& c, const juce::dsp::AudioBlock<IOType>& b, int fade)
+				: cascade(c), block(b), numFadeSamples(fade) {}
+
+			void runTask(int taskIndex) override { cascade.processGroups(block, taskIndex, 1, numFadeSamples); }
+
+			EQCascade& cascade;
+			const juce::dsp::AudioBlock<IOType>& block;
+			const int numFadeSamples;
+		};
+
+		GroupJob job(*this, block, beginBlock((int) block.getNumSamples()));
+
+		//a mid/side pair spread over two scalar groups has to stay on one thread
+		if (isScalarMidSidePair(job.numFadeSamples))
+			processGroups(block, 0, numGroups, job.numFadeSamples);
+		else
+			pool.run(job, numGroups);
+
+		fadeRemaining -= job.numFadeSamples;
+	}
+
+private:
+	enum CoeffPlane { B0, B1, B2, A1, A2, numCoeffPlanes };
+	enum StatePlane { S1, S2, numStatePlanes };
+
+	using StageList = std::array<int, maxStages>;
+
+	/** Keeps the cascade as it was before the first change since the last block, to crossfade from. */
+	void beginChange() noexcept
+	{
+		if (pendingFade)
+			return;
+
+		fadeStages = activeStages;
+		numFadeStages = numActiveStages;
+		fadeMidSide = midSide;
+		std::copy(state, state + getStateSize(), fadeState);
+		pendingFade = true;
+	}
+
+	/** Starts a crossfade if the stage set changed since the last block, and returns how many samples of this block it covers. */
+	int beginBlock(int numSamples) noexcept
+	{
+		if (pendingFade)
+		{
+			pendingFade = false;
+			fadeRemaining = fadeLength;
+		}
+
+		return juce::jmin(fadeRemaining, numSamples, fadeBuffer.getNumSamples());
+	}
+
+	/** Runs a range of channel groups. Ranges that don't overlap touch separate state and may run on different threads. */
+	template <typename IOType>
+	void processGroups(const juce::dsp::AudioBlock<IOType>& block, int firstGroup, int numGroupsToProcess, int numFadeSamples) noexcept
+	{
+		const auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numChannels);
+		const auto numSamples = (int) block.getNumSamples();
+
+		if (numActiveStages == 0 && numFadeSamples == 0)
+			return;
+
+		if (firstGroup == 0 && numGroupsToProcess >= 2 && channelsToProcess >= 2 && isScalarMidSidePair(numFadeSamples))
+		{
+			processScalarMidSidePair(block, numFadeSamples);
+			firstGroup += 2;
+			numGroupsToProcess -= 2;
+		}
+
+		for (int group = firstGroup; group < firstGroup + numGroupsToProcess && group * numLanes < channelsToProcess; ++group)
+		{
+			const auto firstChannel = group * numLanes;
+			const auto groupChannels = juce::jmin(numLanes, channelsToProcess - firstChannel);
+
+			std::array<IOType*, numLanes> channelData {};
+			std::array<SampleType*, numLanes> fadeData {};
+
+			for (int lane = 0; lane < groupChannels; ++lane)
+			{
+				channelData[(size_t) lane] = block.getChannelPointer((size_t) (firstChannel + lane));
+				fadeData[(size_t) lane] = fadeBuffer.getWritePointer(firstChannel + lane);
+			}
+
+			if (numFadeSamples > 0)
+				for (int lane = 0; lane < groupChannels; ++lane)
+					std::copy(channelData[(size_t) lane], channelData[(size_t) lane] + numFadeSamples, fadeData[(size_t) lane]);
+
+			processGroup(group, state, activeStages, numActiveStages, midSide, channelData, groupChannels, numSamples);
+
+			if (numFadeSamples > 0)
+			{
+				processGroup(group, fadeState, fadeStages, numFadeStages, fadeMidSide, fadeData, groupChannels, numFadeSamples);
+
+				for (int lane = 0; lane < groupChannels; ++lane)
+					crossfade(channelData[(size_t) lane], fadeData[(size_t) lane], numFadeSamples);
+			}
+		}
+	}
+
+	/** True when mid/side needs the first two channels but they sit in separate single lane groups. */
+	bool isScalarMidSidePair(int numFadeSamples) const noexcept
+	{
+		return numLanes < 2 && numChannels >= 2 && (midSide || (numFadeSamples > 0 && fadeMidSide));
+	}
+
+	/** Groups 0 and 1 of a scalar build, with the pair encoded in place before and decoded after each cascade that runs in mid/side. */
+	template <typename IOType>
+	void processScalarMidSidePair(const juce::dsp::AudioBlock<IOType>& block, int numFadeSamples) noexcept
+	{
+		const auto numSamples = (int) block.getNumSamples();
+		auto* left = block.getChannelPointer(0);
+		auto* right = block.getChannelPointer(1);
+		auto* fadeLeft = fadeBuffer.getWritePointer(0);
+		auto* fadeRight = fadeBuffer.getWritePointer(1);
+
+		if (numFadeSamples > 0)
+		{
+			std::copy(left, left + numFadeSamples, fadeLeft);
+			std::copy(right, right + numFadeSamples, fadeRight);
+		}
+
+		processScalarPair(state, activeStages, numActiveStages, midSide, left, right, numSamples);
+
+		if (numFadeSamples > 0)
+		{
+			processScalarPair(fadeState, fadeStages, numFadeStages, fadeMidSide, fadeLeft, fadeRight, numFadeSamples);
+			crossfade(left, fadeLeft, numFadeSamples);
+			crossfade(right, fadeRight, numFadeSamples);
+		}
+	}
+
+	template <typename IOType>
+	void processScalarPair(Lanes* stateBase, const StageList& stages, int numStages, bool useMidSide,
+						   IOType* left, IOType* right, int numSamples) const noexcept
+	{
+		if (numStages == 0)
+			return;
+
+		if (useMidSide)
+			for (int i = 0; i < numSamples; ++i)
+			{
+				const auto l = (SampleType) left[i], r = (SampleType) right[i];
+				left[i] = (IOType) ((l + r) * SampleType(0.5));
+				right[i] = (IOType) ((l - r) * SampleType(0.5));
+			}
+
+		processGroup(0, stateBase, stages, numStages, false, std::array<IOType*, numLanes> { left }, 1, numSamples);
+		processGroup(1, stateBase, stages, numStages, false, std::array<IOType*, numLanes> { right }, 1, numSamples);
+
+		if (useMidSide)
+			for (int i = 0; i < numSamples; ++i)
+			{
+				const auto mid = (SampleType) left[i], side = (SampleType) right[i];
+				left[i] = (IOType) (mid + side);
+				right[i] = (IOType) (mid - side);
+			}
+	}
+
+	/** Fades a channel from the old cascade's output to the new one's, picking up where the previous block left off. */
+	template <typename IOType>
+	void crossfade(IOType* out, const SampleType* old, int numFadeSamples) const noexcept
+	{
+		for (int i = 0; i < numFadeSamples; ++i)
+		{
+			const auto gain = (SampleType) (fadeLength - fadeRemaining + i + 1) / (SampleType) fadeLength;
+			out[i] = (IOType) (old[i] + gain * ((SampleType) out[i] - old[i]));
+		}
+	}
+
+	Lanes& coeffAt(int group, int plane, int stageIndex) const noexcept { return coeffs[(group * numCoeffPlanes + plane) * maxStages + stageIndex]; }
+	static Lanes& stateAt(Lanes* base, int group, int plane, int stageIndex) noexcept { return base[(group * numStatePlanes + plane) * maxStages + stageIndex]; }
+
+	void setGroupCoefficients(int group, int stageIndex, SampleType b0, SampleType b1, SampleType b2, SampleType a1, SampleType a2) noexcept
+	{
+		coeffAt(group, B0, stageIndex) = Lanes(b0);
+		coeffAt(group, B1, stageIndex) = Lanes(b1);
+		coeffAt(group, B2, stageIndex) = Lanes(b2);
+		coeffAt(group, A1, stageIndex) = Lanes(a1);
+		coeffAt(group, A2, stageIndex) = Lanes(a2);
+	}
+
+	static void setLane(Lanes& target, int lane, SampleType value) noexcept
+	{
+#if JUCE_USE_SIMD
+		target.set((size_t) lane, value);
+#else
+		juce::ignoreUnused(lane);
+		target = value;
+#endif
+	}
+
+	static Lanes loadLanes(const SampleType* frame) noexcept
+	{
+#if JUCE_USE_SIMD
+		return Lanes::fromRawArray(frame);
+#else
+		return *frame;
+#endif
+	}
+
+	static void storeLanes(Lanes value, SampleType* frame) noexcept
+	{
+#if JUCE_USE_SIMD
+		value.copyToRawArray(frame);
+#else
+		*frame = value;
+#endif
+	}
+
+	template <typename IOType>
+	void processGroup(int group, Lanes* stateBase, const StageList& stages, int numStages, bool useMidSide,
+					  const std::array<IOType*, numLanes>& channelData, int groupChannels, int numSamples) const noexcept
+	{
+		if (numStages == 0)
+			return;
+
+		//the encode and decode are their own inverse up to a factor of two, taken on the way in
+		const auto encode = useMidSide && group == 0 && groupChannels >= 2;
+
+		//gather the stages into dense local planes so the inner loop never skips over disabled slots
+		Lanes b0[maxStages], b1[maxStages], b2[maxStages], a1[maxStages], a2[maxStages], s1[maxStages], s2[maxStages];
+
+		for (int k = 0; k < numStages; ++k)
+		{
+			const auto stageIndex = stages[(size_t) k];
+			b0[k] = coeffAt(group, B0, stageIndex);
+			b1[k] = coeffAt(group, B1, stageIndex);
+			b2[k] = coeffAt(group, B2, stageIndex);
+			a1[k] = coeffAt(group, A1, stageIndex);
+			a2[k] = coeffAt(group, A2, stageIndex);
+			s1[k] = stateAt(stateBase, group, S1, stageIndex);
+			s2[k] = stateAt(stateBase, group, S2, stageIndex);
+		}
+
+		alignas(alignof(Lanes)) SampleType frame[numLanes] = {};
+
+		for (int i = 0; i < numSamples; ++i)
+		{
+			for (int lane = 0; lane < groupChannels; ++lane)
+				frame[lane] = (SampleType) channelData[(size_t) lane][i];
+
+			if (encode)
+			{
+				const auto left = frame[0], right = frame[1];
+				frame[0] = (left + right) * SampleType(0.5);
+				frame[1] = (left - right) * SampleType(0.5);
+			}
+
+			auto x = loadLanes(frame);
+
+			for (int k = 0; k < numStages; ++k)
+			{
+				const auto y = b0[k] * x + s1[k];
+				s1[k] = b1[k] * x - a1[k] * y + s2[k];
+				s2[k] = b2[k] * x - a2[k] * y;
+				x = y;
+			}
+
+			storeLanes(x, frame);
+
+			if (encode)
+			{
+				const auto mid = frame[0], side = frame[1];
+				frame[0] = mid + side;
+				frame[1] = mid - side;
+			}
+
+			for (int lane = 0; lane < groupChannels; ++lane)
+				channelData[(size_t) lane][i] = (IOType) frame[lane];
+		}
+
+		for (int k = 0; k < numStages; ++k)
+		{
+			const auto stageIndex = stages[(size_t) k];
+			stateAt(stateBase, group, S1, stageIndex) = s1[k];
+			stateAt(stateBase, group, S2, stageIndex) = s2[k];
+		}
+	}
+
+	juce::HeapBlock<char> arenaMemory;
+	Lanes* coeffs = nullptr;
+	Lanes* state = nullptr;
+	Lanes* fadeState = nullptr;
+	int numChannels = 0, numGroups = 0;
+
+	std::array<bool, maxStages> stageEnabled;
+	StageList activeStages {};
+	int numActiveStages = 0;
+
+	//the cascade as it was before the last change, run alongside the new one while fading
+	juce::AudioBuffer<SampleType> fadeBuffer;
+	StageList fadeStages {};
+	int numFadeStages = 0;
+	int fadeLength = 1, fadeRemaining = 0;
+	bool pendingFade = false;
+
+	bool midSide = false, fadeMidSide = false;
+
+	JUCE_DECLARE_NON_COPYABLE(EQCascade)
+};
@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    The editor's view of the EQ: pre and post spectrum under the response curve.
+
+  ==============================================================================
+*/
+
+#include "EQDisplay.h"
+
+//==============================================================================
+EQDisplay::EQDisplay(Parametric_EQ_PluginAudioProcessor& processorToShow)
+	: processor(processorToShow), analyzer(processorToShow.getAnalyzer())
+{
+	sections.reserve(12);
+	setOpaque(true);
+
+	analyzer.setActive(true);
+	startTimerHz(30);
+}
+
+EQDisplay::~EQDisplay()
+{
+	analyzer.setActive(false);
+}
+
+void EQDisplay::paint(juce::Graphics& g)
+{
+	g.drawImageAt(background, 0, 0);
+
+	g.setColour(juce::Colours::lightblue.withAlpha(0.25f));
+	g.fillPath(spectrumPaths[SpectrumAnalyzer::Pre]);
+
+	g.setColour(juce::Colours::orange.withAlpha(0.8f));
+	g.strokePath(spectrumPaths[SpectrumAnalyzer::Post], juce::PathStrokeType(1.0f));
+
+	g.setColour(juce::Colours::white);
+	g.strokePath(responsePath, juce::PathStrokeType(2.0f, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+}
+
+void EQDisplay::resized()
+{
+	drawBackground();
+	updateColumns();
+}
+
+//==============================================================================
+void EQDisplay::timerCallback()
+{
+	auto needsRepaint = false;
+
+	if (analyzer.getSampleRate() != pointSampleRate)
+		updateColumns();
+
+	//read before the settings, so a change that lands while reading them is picked up next frame
+	const auto version = processor.getSettingsVersion();
+
+	if (! responseValid || version != responseVersion)
+	{
+		responseVersion = version;
+		updateResponse();
+		needsRepaint = true;
+	}
+
+	for (int tap = 0; tap < SpectrumAnalyzer::NumTaps; ++tap)
+	{
+		if (analyzer.getSpectrum((SpectrumAnalyzer::Tap) tap, spectra[(size_t) tap]))
+		{
+			updateSpectrumPath((SpectrumAnalyzer::Tap) tap);
+			needsRepaint = true;
+		}
+	}
+
+	if (needsRepaint)
+		repaint();
+}
+
+void EQDisplay::updateColumns()
+{
+	pointSampleRate = analyzer.getSampleRate();
+
+	const auto numPoints = juce::jmax(2, getWidth() / pixelsPerPoint + 1);
+	const auto binWidth = pointSampleRate / SpectrumAnalyzer::fftSize;
+
+	pointFrequencies.resize((size_t) numPoints);
+	pointBins.resize((size_t) numPoints);
+
+	for (int i = 0; i < numPoints; ++i)
+	{
+		const auto proportion = (double) i / (numPoints - 1);
+		pointFrequencies[(size_t) i] = minFrequency * std::pow(maxFrequency / minFrequency, proportion);
+	}
+
+	//each point covers the bins up to halfway to its neighbours, at the top end that's many bins per point
+	for (int i = 0; i < numPoints; ++i)
+	{
+		const auto lower = i > 0 ? std::sqrt(pointFrequencies[(size_t) i] * pointFrequencies[(size_t) (i - 1)]) : pointFrequencies[0];
+		const auto upper = i < numPoints - 1 ? std::sqrt(pointFrequencies[(size_t) i] * pointFrequencies[(size_t) (i + 1)]) : pointFrequencies[(size_t) i];
+
+		const auto first = juce::jlimit(0, SpectrumAnalyzer::numBins - 1, juce::roundToInt(lower / binWidth));
+		const auto last = juce::jlimit(first, SpectrumAnalyzer::numBins - 1, juce::roundToInt(upper / binWidth));
+
+		pointBins[(size_t) i] = { first, last };
+	}
+
+	responseValid = false;
+
+	for (int tap = 0; tap < SpectrumAnalyzer::NumTaps; ++tap)
+		updateSpectrumPath((SpectrumAnalyzer::Tap) tap);
+}
+
+void EQDisplay::updateResponse()
+{
+	using Coefficients = juce::dsp::IIR::ArrayCoefficients<double>;
+
+	const auto settings = getChainSettings(processor.apvts);
+	const auto sampleRate = pointSampleRate;
+	const auto maxCorner = sampleRate * 0.49;
+
+	responseValid = true;
+	sections.clear();
+
+	const auto addCut = [&](bool highPass, float freq, Slope slope)
+	{
+		const auto order = 2 * ((int) slope + 1);
+		const auto corner = juce::jmin((double) freq, maxCorner);
+
+		for (int i = 0; i < order / 2; ++i)
+		{
+			const auto q = CutFilterDesigns::getSectionQ(order, i);
+			sections.push_back(highPass ? Coefficients::makeHighPass(sampleRate, corner, q) : Coefficients::makeLowPass(sampleRate, corner, q));
+		}
+	};
+
+	const auto gain = [](float decibels) { return juce::Decibels::decibelsToGain((double) decibels); };
+
+	//the same rules the processor uses to take bands out of the cascade
+	if (settings.lowCutFreq > CoefficientTables::minFreq)
+		addCut(true, settings.lowCutFreq, settings.lowCutSlope);
+
+	if (settings.lowShelfGainDB != 0.0f)
+		sections.push_back(Coefficients::makeLowShelf(sampleRate, juce::jmin((double) settings.lowShelfFreq, maxCorner), settings.lowShelfQ, gain(settings.lowShelfGainDB)));
+
+	if (settings.lowMidGainDB != 0.0f)
+		sections.push_back(Coefficients::makePeakFilter(sampleRate, juce::jmin((double) settings.lowMidFreq, maxCorner), settings.lowMidQ, gain(settings.lowMidGainDB)));
+
+	if (settings.midGainDB != 0.0f)
+		sections.push_back(Coefficients::makePeakFilter(sampleRate, juce::jmin((double) settings.midFreq, maxCorner), settings.midQ, gain(settings.midGainDB)));
+
+	if (settings.hiShelfGainDB != 0.0f)
+		sections.push_back(Coefficients::makeHighShelf(sampleRate, juce::jmin((double) settings.hiShelfFreq, maxCorner), settings.hiShelfQ, gain(settings.hiShelfGainDB)));
+
+	if (settings.hiCutFreq < CoefficientTables::maxFreq)
+		addCut(false, settings.hiCutFreq, settings.highCutSlope);
+
+	responsePath.clear();
+	responsePath.preallocateSpace(3 * (int) pointFrequencies.size());
+
+	for (size_t i = 0; i < pointFrequencies.size(); ++i)
+	{
+		const auto w = juce::MathConstants<double>::twoPi * juce::jmin(pointFrequencies[i], sampleRate * 0.5) / sampleRate;
+		const auto cos1 = std::cos(w), sin1 = std::sin(w);
+		const auto cos2 = std::cos(2.0 * w), sin2 = std::sin(2.0 * w);
+
+		auto magnitudeSquared = 1.0;
+
+		for (const auto& c : sections)
+		{
+			const auto numRe = c[0] + c[1] * cos1 + c[2] * cos2;
+			const auto numIm = c[1] * sin1 + c[2] * sin2;
+			const auto denRe = c[3] + c[4] * cos1 + c[5] * cos2;
+			const auto denIm = c[4] * sin1 + c[5] * sin2;
+
+			magnitudeSquared *= (numRe * numRe + numIm * numIm) / (denRe * denRe + denIm * denIm);
+		}
+
+		const auto x = frequencyToX(pointFrequencies[i]);
+		const auto y = responseToY((float) (10.0 * std::log10(juce::jmax(magnitudeSquared, 1.0e-20))));
+
+		if (i == 0)
+			responsePath.startNewSubPath(x, y);
+		else
+			responsePath.lineTo(x, y);
+	}
+}
+
+void EQDisplay::updateSpectrumPath(SpectrumAnalyzer::Tap tap)
+{
+	const auto& spectrum = spectra[(size_t) tap];
+	auto& path = spectrumPaths[(size_t) tap];
+	const auto bottom = (float) getHeight();
+
+	path.clear();
+	path.preallocateSpace(3 * (int) pointBins.size() + 6);
+	path.startNewSubPath(0.0f, bottom);
+
+	//the loudest bin under each point, so narrow peaks don't vanish where many bins share a point
+	for (size_t i = 0; i < pointBins.size(); ++i)
+	{
+		auto level = SpectrumAnalyzer::minDecibels;
+
+		for (int bin = pointBins[i].first; bin <= pointBins[i].second; ++bin)
+			level = juce::jmax(level, spectrum[(size_t) bin]);
+
+		path.lineTo(frequencyToX(pointFrequencies[i]), spectrumToY(level));
+	}
+
+	path.lineTo((float) getWidth(), bottom);
+	path.closeSubPath();
+}
+
+void EQDisplay::drawBackground()
+{
+	background = juce::Image(juce::Image::RGB, juce::jmax(1, getWidth()), juce::jmax(1, getHeight()), true);
+	juce::Graphics g(background);
+
+	g.fillAll(juce::Colours::black);
+	g.setFont(11.0f);
+
+	const auto width = (float) getWidth();
+	const auto height = (float) getHeight();
+
+	for (auto freq : { 20.0, 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0, 5000.0, 10000.0, 20000.0 })
+	{
+		const auto x = frequencyToX(freq);
+
+		g.setColour(juce::Colours::dimgrey);
+		g.drawVerticalLine(juce::roundToInt(x), 0.0f, height);
+
+		g.setColour(juce::Colours::lightgrey);
+		g.drawText(freq >= 1000.0 ? juce::String(freq / 1000.0) + "k" : juce::String(freq), juce::roundToInt(x) + 3, (int) height - 14, 40, 12,
+				   juce::Justification::left);
+	}
+
+	for (auto decibels : { -24.0f, -12.0f, 0.0f, 12.0f, 24.0f })
+	{
+		const auto y = responseToY(decibels);
+
+		g.setColour(decibels == 0.0f ? juce::Colours::grey : juce::Colours::dimgrey);
+		g.drawHorizontalLine(juce::roundToInt(y), 0.0f, width);
+
+		g.setColour(juce::Colours::lightgrey);
+		g.drawText(juce::String(decibels, 0) + " dB", 3, juce::roundToInt(y) + 1, 50, 12, juce::Justification::left);
+	}
+}
+
+//==============================================================================
+float EQDisplay::frequencyToX(double freq) const noexcept
+{
+	return (float) (getWidth() * std::log(freq / minFrequency) / std::log(maxFrequency / minFrequency));
+}
+
+float EQDisplay::responseToY(float decibels) const noexcept
+{
+	return juce::jmap(decibels, responseRange, -responseRange, 0.0f, (float) getHeight());
+}
+
+float EQDisplay::spectrumToY(float decibels) const noexcept
+{
+	return juce::jmap(juce::jmax(decibels, spectrumFloor), 0.0f, spectrumFloor, 0.0f, (float) getHeight());
+}
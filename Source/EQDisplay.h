@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    The editor's view of the EQ: pre and post spectrum under the response curve.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+	Draws the analyzer's pre and post EQ spectra and the combined magnitude
+	response of every active band on a log frequency axis.
+
+	Everything that doesn't change from frame to frame is cached: the grid is
+	drawn into an image on resize, each column's frequency and FFT bin range are
+	worked out once per size and sample rate, and the response curve is only
+	recomputed when the processor's settings version moves. A frame with no new
+	spectrum and no settings change doesn't repaint at all.
+*/
+class EQDisplay : public juce::Component,
+				  private juce::Timer
+{
+public:
+	explicit EQDisplay(Parametric_EQ_PluginAudioProcessor& processorToShow);
+	~EQDisplay() override;
+
+	void paint(juce::Graphics& g) override;
+	void resized() override;
+
+private:
+	void timerCallback() override;
+
+	void updateColumns();
+	void updateResponse();
+	void updateSpectrumPath(SpectrumAnalyzer::Tap tap);
+	void drawBackground();
+
+	float frequencyToX(double freq) const noexcept;
+	float responseToY(float decibels) const noexcept;
+	float spectrumToY(float decibels) const noexcept;
+
+	static constexpr double minFrequency = 20.0;
+	static constexpr double maxFrequency = 20000.0;
+	static constexpr float responseRange = 24.0f;
+	static constexpr float spectrumFloor = -96.0f;
+
+	//one point every few pixels is as smooth as the eye can tell, at a fraction of the path building
+	static constexpr int pixelsPerPoint = 2;
+
+	Parametric_EQ_PluginAudioProcessor& processor;
+	SpectrumAnalyzer& analyzer;
+
+	juce::Image background;
+	juce::Path responsePath;
+	std::array<juce::Path, SpectrumAnalyzer::NumTaps> spectrumPaths;
+	std::array<SpectrumAnalyzer::Spectrum, SpectrumAnalyzer::NumTaps> spectra {};
+
+	//per point along the x axis: its frequency and the FFT bins that fall under it
+	std::vector<double> pointFrequencies;
+	std::vector<std::pair<int, int>> pointBins;
+	std::vector<std::array<double, 6>> sections;
+	double pointSampleRate = 0.0;
+
+	juce::uint32 responseVersion = 0;
+	bool responseValid = false;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EQDisplay)
+};
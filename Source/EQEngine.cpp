@@ -0,0 +1,832 @@
+/*
+  ==============================================================================
+
+    The EQ's signal path on its own: bands, cascades, oversampling, linear
+    phase and dynamics, with no parameters, buses or host around it.
+
+  ==============================================================================
+*/
+
+#include "EQEngine.h"
+
+//==============================================================================
+void EQEngine::prepare(const Setup& newSetup, const ChainSettings& settings, const Options& newOptions)
+{
+	setup = newSetup;
+	options = newOptions;
+
+	juce::dsp::ProcessSpec spec;
+
+	spec.maximumBlockSize = (juce::uint32) setup.maximumBlockSize;
+	spec.numChannels = (juce::uint32) setup.numChannels;
+	spec.sampleRate = setup.sampleRate;
+
+	cascade.prepare(spec);
+	doubleCascade.prepare(spec);
+	singlePrecisionScratch.setSize(setup.doublePrecision ? setup.numChannels : 0, setup.doublePrecision ? setup.maximumBlockSize : 0);
+
+	//offline renders of wide buses split the channel groups across a pool made once here, never per block
+	const auto numWorkers = juce::jmin(cascade.getNumGroups(), juce::SystemStats::getNumCpus()) - 1;
+
+	if (! options.nonRealtime || numWorkers <= 0)
+		workerPool.reset();
+	else if (workerPool == nullptr || workerPool->getNumWorkers() != numWorkers)
+		workerPool = std::make_unique<ChannelWorkerPool>(numWorkers);
+	tables = tableCache->getTables(setup.sampleRate);
+	cutDesigns.prepare(tables);
+
+	//the oversampled cascade is sized for 4x, at 2x its crossfades just take twice as long
+	oversampledCascade.prepare({ setup.sampleRate * 4.0, spec.maximumBlockSize * 4, spec.numChannels });
+
+	for (int i = 0; i < numOversamplingRates; ++i)
+	{
+		oversamplers[(size_t) i] = std::make_unique<juce::dsp::Oversampling<float>>(spec.numChannels, (size_t) (i + 1),
+																					   juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, false, true);
+		oversamplers[(size_t) i]->initProcessing((size_t) setup.maximumBlockSize);
+
+		oversampledTables[(size_t) i] = tableCache->getTables(setup.sampleRate * (2 << i));
+		oversampledCutDesigns[(size_t) i].prepare(oversampledTables[(size_t) i]);
+	}
+
+	setOversamplingFactor(options.oversamplingFactor);
+	mixedPrecision = options.mixedPrecision;
+
+	//dynamic bands start at their static gain, with the detectors settled on silence
+	detector.prepare(setup.sampleRate);
+	dynamicKey.assign((size_t) setup.maximumBlockSize, 0.0f);
+	dynamicGainDB.fill(0.0f);
+
+	for (int i = 0; i < DynamicDetector::numBands; ++i)
+		bandDynamic[dynamicBands[(size_t) i]] = options.dynamicRanges[(size_t) i] != 0.0f;
+
+	//a ramp lasts at least a host block, so a value the host only updates once per block glides from one
+	//block to the next instead of stepping, however large the buffers are
+	const auto rampSeconds = juce::jmax(smoothingTimeSeconds, setup.maximumBlockSize / setup.sampleRate);
+
+	for (auto& band : smoothers)
+	{
+		band.freq.reset(setup.sampleRate, rampSeconds);
+		band.q.reset(setup.sampleRate, rampSeconds);
+		band.gainDB.reset(setup.sampleRate, rampSeconds);
+	}
+
+	updateStereoMode();
+
+	currentSettings = settings;
+	pendingBands.fill(true);
+	snapBands = false;
+
+	//start every band at its current settings rather than ramping in from the smoother defaults
+	for (auto pos : { ChainPos::LowShelf, ChainPos::LowMidPeak, ChainPos::MidPeak, ChainPos::HiShelf })
+	{
+		const auto target = getBandSettings(settings, pos);
+		smoothers[pos].freq.setCurrentAndTargetValue(target.freq);
+		smoothers[pos].q.setCurrentAndTargetValue(target.q);
+		smoothers[pos].gainDB.setCurrentAndTargetValue(target.gainDB);
+	}
+
+	smoothers[ChainPos::LowCut].freq.setCurrentAndTargetValue(settings.lowCutFreq);
+	smoothers[ChainPos::HiCut].freq.setCurrentAndTargetValue(settings.hiCutFreq);
+
+	applyPendingBands();
+
+	//in linear phase mode the first FIR is designed here, so playback doesn't start on silence
+	linearPhase.prepare(spec);
+	linearPhaseActive = options.linearPhase;
+	curveChanged = false;
+
+	if (linearPhaseActive)
+	{
+		designedFirLength = options.firLength;
+		linearPhase.designNow(makeLinearPhaseCurve(settings, designedFirLength));
+		linearPhase.startDesigner();
+	}
+
+	//playback starts on the new band set directly, there is nothing to crossfade from yet
+	cascade.reset();
+	doubleCascade.reset();
+	oversampledCascade.reset();
+
+	prepared = true;
+}
+
+void EQEngine::release()
+{
+	prepared = false;
+
+	cascade.release();
+	doubleCascade.release();
+	oversampledCascade.release();
+	linearPhase.release();
+	linearPhaseActive = false;
+
+	for (auto& oversampler : oversamplers)
+		oversampler.reset();
+
+	//the tables for a rate are freed once no engine holds them
+	tables.reset();
+	cutDesigns.release();
+
+	for (int i = 0; i < numOversamplingRates; ++i)
+	{
+		oversampledTables[(size_t) i].reset();
+		oversampledCutDesigns[(size_t) i].release();
+	}
+
+	workerPool.reset();
+	singlePrecisionScratch.setSize(0, 0);
+	std::vector<float>().swap(dynamicKey);
+}
+
+void EQEngine::reset()
+{
+	//clears what the filters have heard and nothing else, so it's cheap enough for every transport jump
+	cascade.reset();
+	doubleCascade.reset();
+	oversampledCascade.reset();
+	linearPhase.reset();
+	detector.reset();
+
+	for (auto& oversampler : oversamplers)
+		if (oversampler != nullptr)
+			oversampler->reset();
+}
+
+void EQEngine::setSettings(const ChainSettings& settings, const BandFlags& changed, bool jump)
+{
+	currentSettings = settings;
+
+	for (int pos = 0; pos < NumChainPos; ++pos)
+	{
+		pendingBands[(size_t) pos] = pendingBands[(size_t) pos] || changed[(size_t) pos] || jump;
+		curveChanged = curveChanged || changed[(size_t) pos] || jump;
+	}
+
+	snapBands = snapBands || jump;
+}
+
+void EQEngine::setOptions(const Options& newOptions)
+{
+	options = newOptions;
+}
+
+void EQEngine::process(const juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<const float>& key)
+{
+	processSamples(block, key);
+}
+
+void EQEngine::process(const juce::dsp::AudioBlock<double>& block, const juce::dsp::AudioBlock<const double>& key)
+{
+	processSamples(block, key);
+}
+
+template <typename SampleType>
+void EQEngine::processSamples(const juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<const SampleType>& key)
+{
+	//released, there are no filters, tables or oversamplers to run until the next prepare
+	if (! prepared)
+		return;
+
+	juce::ScopedNoDenormals noDenormals;
+
+	applyOptions();
+	applyPendingBands();
+
+	const auto numSamples = (int) block.getNumSamples();
+	const auto step = options.smoothingStep;
+
+	if (options.linearPhase)
+	{
+		//switching over starts the convolver clean rather than on whatever it last heard
+		if (! linearPhaseActive)
+			linearPhase.reset();
+
+		if (! linearPhaseActive || curveChanged || options.firLength != designedFirLength)
+		{
+			curveChanged = false;
+			designedFirLength = options.firLength;
+			linearPhase.requestDesign(makeLinearPhaseCurve(currentSettings, designedFirLength));
+		}
+
+		linearPhaseActive = true;
+		processInSinglePrecision(block, [this](const juce::dsp::AudioBlock<float>& singleBlock) { linearPhase.process(singleBlock); });
+
+		//the smoothers keep following the settings, so switching back lands on the current curve
+		advanceSmoothing(numSamples);
+		return;
+	}
+
+	if (linearPhaseActive)
+	{
+		linearPhaseActive = false;
+		cascade.reset();
+		doubleCascade.reset();
+		oversampledCascade.reset();
+		detector.reset();
+
+		for (auto& oversampler : oversamplers)
+			oversampler->reset();
+	}
+
+	//dynamic bands only run at minimum phase, the key is taken before any band touches the block
+	const auto dynamic = prepareDynamics(key, numSamples);
+
+	//while a band is ramping or dynamic, the block is cut into step sized pieces and its coefficients are rebuilt between them
+	for (int start = 0; start < numSamples;)
+	{
+		auto length = numSamples - start;
+
+		if (step > 0 && isSmoothing())
+			length = juce::jmin(length, step);
+
+		if (dynamic)
+		{
+			length = juce::jmin(length, dynamicStep);
+			updateDynamics(start, length);
+		}
+
+		//all channels run through the whole cascade together, one channel per SIMD lane
+		auto segment = block.getSubBlock((size_t) start, (size_t) length);
+
+		//with double precision audio every band at the host rate runs in the double cascade
+		if constexpr (std::is_same_v<SampleType, float>)
+			processCascade(cascade, segment);
+
+		processCascade(doubleCascade, segment);
+
+		//the oversamplers run even with no band above the threshold, so the reported latency never changes under the host
+		if (oversamplingFactor > 1)
+		{
+			processInSinglePrecision(segment, [this](juce::dsp::AudioBlock<float> singleBlock)
+			{
+				auto& oversampler = *oversamplers[(size_t) getOversamplingIndex()];
+
+				processCascade(oversampledCascade, oversampler.processSamplesUp(singleBlock));
+				oversampler.processSamplesDown(singleBlock);
+			});
+		}
+
+		advanceSmoothing(length);
+
+		start += length;
+	}
+}
+
+void EQEngine::applyOptions()
+{
+	if (options.oversamplingFactor != oversamplingFactor)
+		setOversamplingFactor(options.oversamplingFactor);
+
+	//switching precision moves the low bands between cascades
+	if (options.mixedPrecision != mixedPrecision)
+	{
+		mixedPrecision = options.mixedPrecision;
+		pendingBands.fill(true);
+	}
+
+	updateStereoMode();
+}
+
+void EQEngine::applyPendingBands()
+{
+	cutFilterUpdate(currentSettings);
+	peakFilterUpdate(currentSettings);
+	shelfFilterUpdate(currentSettings);
+
+	//a jump only applies to the settings it came with, later changes ramp again
+	snapBands = false;
+}
+
+bool EQEngine::consumePending(ChainPos pos)
+{
+	return std::exchange(pendingBands[pos], false);
+}
+
+//==============================================================================
+int EQEngine::getLatencySamples() const
+{
+	if (options.linearPhase)
+		return linearPhase.getLatencySamples(options.firLength);
+
+	//nothing to delay by between release() and the next prepare()
+	if (oversamplingFactor > 1 && oversamplers[(size_t) getOversamplingIndex()] != nullptr)
+		return juce::roundToInt(oversamplers[(size_t) getOversamplingIndex()]->getLatencyInSamples());
+
+	return 0;
+}
+
+bool EQEngine::needsDesigner() const noexcept
+{
+	return prepared && options.linearPhase && ! linearPhase.isDesignerRunning();
+}
+
+void EQEngine::startDesigner()
+{
+	linearPhase.startDesigner();
+}
+
+double EQEngine::getRingSeconds(const ChainSettings& settings, const Options& options)
+{
+	//a biquad's envelope falls by 1/e every Q / (pi f) seconds, so it takes about 6.9 of those to fall by 60 dB
+	const auto ring = [](float freq, double q) { return 6.91 * q / (juce::MathConstants<double>::pi * juce::jmax(1.0f, freq)); };
+
+	//the cut's last section has the highest Q
+	const auto cutQ = [](Slope slope)
+	{
+		const auto order = 2 * ((int) slope + 1);
+		return CutFilterDesigns::getSectionQ(order, order / 2 - 1);
+	};
+
+	auto seconds = 0.0;
+
+	if (settings.lowCutFreq > CoefficientTables::minFreq)
+		seconds = juce::jmax(seconds, ring(settings.lowCutFreq, cutQ(settings.lowCutSlope)));
+
+	if (settings.hiCutFreq < CoefficientTables::maxFreq)
+		seconds = juce::jmax(seconds, ring(settings.hiCutFreq, cutQ(settings.highCutSlope)));
+
+	//every peak and shelf band can be dynamic, and a dynamic band can be engaged whatever its static gain
+	for (size_t i = 0; i < dynamicBands.size(); ++i)
+	{
+		const auto band = getBandSettings(settings, dynamicBands[i]);
+
+		if (band.gainDB != 0.0f || options.dynamicRanges[i] != 0.0f)
+			seconds = juce::jmax(seconds, ring(band.freq, band.q));
+	}
+
+	return seconds;
+}
+
+//==============================================================================
+void EQEngine::peakFilterUpdate(const ChainSettings& settings)
+{
+	if (consumePending(ChainPos::LowMidPeak))
+		setBandTarget(ChainPos::LowMidPeak, getBandSettings(settings, ChainPos::LowMidPeak));
+
+	if (consumePending(ChainPos::MidPeak))
+		setBandTarget(ChainPos::MidPeak, getBandSettings(settings, ChainPos::MidPeak));
+}
+
+void EQEngine::cutFilterUpdate(const ChainSettings& settings)
+{
+	//a cut parked at the end of its range is treated as switched off
+	if (consumePending(ChainPos::LowCut))
+		setCutTarget(ChainPos::LowCut, settings.lowCutFreq, 2 * (settings.lowCutSlope + 1), settings.lowCutFreq > CoefficientTables::minFreq);
+
+	if (consumePending(ChainPos::HiCut))
+		setCutTarget(ChainPos::HiCut, settings.hiCutFreq, 2 * (settings.highCutSlope + 1), settings.hiCutFreq < CoefficientTables::maxFreq);
+}
+
+void EQEngine::setCutTarget(ChainPos pos, float freq, int order, bool active)
+{
+	auto& cutFreq = smoothers[pos].freq;
+
+	//only the corner of a running cut glides, switching it on or off or changing its slope takes effect at once
+	const auto glide = options.smoothingStep > 0 && ! snapBands && active && cutActive[pos] && order == cutOrder[pos];
+
+	cutOrder[pos] = order;
+	cutActive[pos] = active;
+
+	//as with the peak and shelf bands, the cut moves between cascades only when its target is set, not at every step of a glide
+	bandRoute[pos] = getRoute(freq);
+
+	if (glide)
+		cutFreq.setTargetValue(freq);
+	else
+		cutFreq.setCurrentAndTargetValue(freq);
+
+	updateCutCoefficients(pos);
+}
+
+void EQEngine::updateCutCoefficients(ChainPos pos)
+{
+	setCutStages(pos, pos == ChainPos::LowCut ? CutFilterDesigns::Type::HighPass : CutFilterDesigns::Type::LowPass,
+				 smoothers[pos].freq.getCurrentValue(), cutOrder[pos], cutActive[pos]);
+}
+
+void EQEngine::setCutStages(ChainPos pos, CutFilterDesigns::Type type, float freq, int order, bool active)
+{
+	const auto route = bandRoute[pos];
+	const auto* design = route == Route::Double ? nullptr : &getCutDesigns(pos).getDesign(type, freq, order);
+
+	//sections beyond the chosen slope, or all of them when the cut is off, are taken out of the cascade rather than bypassed per sample
+	for (int i = 0; i < cutStages; ++i)
+	{
+		const auto stage = stageIndex(pos) + i;
+		const auto enabled = active && i < order / 2;
+
+		if (enabled && route == Route::Double)
+			setStageCoefficients(doubleCascade, pos, stage, makePreciseCutSection(type, freq, order, i));
+		else if (enabled)
+			setStageCoefficients(getFloatCascade(pos), pos, stage, design->sections[(size_t) i]);
+
+		enableStage(pos, stage, enabled);
+	}
+
+	coefficientUpdates += active ? order / 2 : 0;
+}
+
+void EQEngine::shelfFilterUpdate(const ChainSettings& settings)
+{
+	if (consumePending(ChainPos::LowShelf))
+		setBandTarget(ChainPos::LowShelf, getBandSettings(settings, ChainPos::LowShelf));
+
+	if (consumePending(ChainPos::HiShelf))
+		setBandTarget(ChainPos::HiShelf, getBandSettings(settings, ChainPos::HiShelf));
+}
+
+EQEngine::BandSettings EQEngine::getBandSettings(const ChainSettings& settings, ChainPos pos)
+{
+	switch (pos)
+	{
+	case LowShelf:
+		return { settings.lowShelfFreq, settings.lowShelfQ, settings.lowShelfGainDB };
+	case LowMidPeak:
+		return { settings.lowMidFreq, settings.lowMidQ, settings.lowMidGainDB };
+	case MidPeak:
+		return { settings.midFreq, settings.midQ, settings.midGainDB };
+	case HiShelf:
+		return { settings.hiShelfFreq, settings.hiShelfQ, settings.hiShelfGainDB };
+	default:
+		jassertfalse;
+		return {};
+	}
+}
+
+void EQEngine::setBandTarget(ChainPos pos, const BandSettings& target)
+{
+	auto& band = smoothers[pos];
+
+	//the band moves between cascades only when its target is set, not at every step of a ramp
+	bandRoute[pos] = getRoute(target.freq);
+
+	if (options.smoothingStep > 0 && ! snapBands)
+	{
+		band.freq.setTargetValue(target.freq);
+		band.q.setTargetValue(target.q);
+		band.gainDB.setTargetValue(target.gainDB);
+	}
+	else
+	{
+		band.freq.setCurrentAndTargetValue(target.freq);
+		band.q.setCurrentAndTargetValue(target.q);
+		band.gainDB.setCurrentAndTargetValue(target.gainDB);
+	}
+
+	updateBandCoefficients(pos);
+}
+
+void EQEngine::updateBandCoefficients(ChainPos pos)
+{
+	//table lookups only, so this is cheap enough to run every smoothing step and never touches the heap
+	const auto& band = smoothers[pos];
+	const auto freq = band.freq.getCurrentValue();
+	const auto q = band.q.getCurrentValue();
+	//the dynamic offset can push a band past the gain parameter's range, every route is held to the range the tables cover
+	const auto gainDB = juce::jlimit(CoefficientTables::minGainDB, CoefficientTables::maxGainDB, band.gainDB.getCurrentValue() + dynamicGainDB[pos]);
+
+	const auto stage = stageIndex(pos);
+
+	//the double cascade gets exact coefficients, table values are only float accurate
+	if (bandRoute[pos] == Route::Double)
+	{
+		setStageCoefficients(doubleCascade, pos, stage, makePreciseBandCoefficients(pos, freq, q, gainDB));
+	}
+	else
+	{
+		const auto& bandTables = getTables(pos);
+		auto& target = getFloatCascade(pos);
+
+		switch (pos)
+		{
+		case LowShelf:
+			setStageCoefficients(target, pos, stage, bandTables.makeLowShelf(freq, q, gainDB));
+			break;
+		case HiShelf:
+			setStageCoefficients(target, pos, stage, bandTables.makeHighShelf(freq, q, gainDB));
+			break;
+		default:
+			setStageCoefficients(target, pos, stage, bandTables.makePeakFilter(freq, q, gainDB));
+			break;
+		}
+	}
+
+	//at 0 dB a peak or shelf is an exact identity, so a static band only costs anything while it is doing something
+	enableStage(pos, stage, gainDB != 0.0f || bandDynamic[pos]);
+	++coefficientUpdates;
+}
+
+void EQEngine::updateStereoMode()
+{
+	const auto mode = options.stereoMode;
+
+	if ((mode == StereoMode::MidSide) != midSide)
+	{
+		midSide = ! midSide;
+		cascade.setMidSide(midSide);
+		doubleCascade.setMidSide(midSide);
+		oversampledCascade.setMidSide(midSide);
+	}
+
+	//a band only needs rebuilding when the channel it runs on moves
+	for (int pos = 0; pos < NumChainPos; ++pos)
+	{
+		const auto channel = mode == StereoMode::Linked ? -1 : juce::jlimit(-1, 1, options.bandChannels[(size_t) pos]);
+
+		if (channel != bandChannel[(size_t) pos])
+		{
+			bandChannel[(size_t) pos] = channel;
+			pendingBands[(size_t) pos] = true;
+		}
+	}
+}
+
+template <typename CascadeType, typename CoefficientType>
+void EQEngine::setStageCoefficients(CascadeType& target, ChainPos pos, int stage, const std::array<CoefficientType, 6>& c) noexcept
+{
+	const auto channel = bandChannel[pos];
+
+	//every channel gets the band, which covers a mono bus with no pair to split, and on wider buses
+	//the channels past the first two, which have no partner and so always run linked
+	target.setCoefficients(stage, c);
+
+	//a band on one side of the pair leaves the other side a pass-through stage in its lane
+	if (channel >= 0 && target.getNumChannels() >= 2)
+		target.setCoefficients(stage, 1 - channel, std::array<CoefficientType, 6> { 1, 0, 0, 1, 0, 0 });
+}
+
+bool EQEngine::isSmoothing() const
+{
+	for (const auto& band : smoothers)
+		if (band.freq.isSmoothing() || band.q.isSmoothing() || band.gainDB.isSmoothing())
+			return true;
+
+	return false;
+}
+
+void EQEngine::advanceSmoothing(int numSamples)
+{
+	//only the bands still ramping are rebuilt, the rest of the cascade is left alone
+	for (int i = 0; i < NumChainPos; ++i)
+	{
+		const auto pos = (ChainPos) i;
+		auto& band = smoothers[pos];
+
+		if (! (band.freq.isSmoothing() || band.q.isSmoothing() || band.gainDB.isSmoothing()))
+			continue;
+
+		band.freq.skip(numSamples);
+		band.q.skip(numSamples);
+		band.gainDB.skip(numSamples);
+
+		if (pos == ChainPos::LowCut || pos == ChainPos::HiCut)
+			updateCutCoefficients(pos);
+		else
+			updateBandCoefficients(pos);
+	}
+}
+
+//==============================================================================
+template <typename SampleType>
+bool EQEngine::prepareDynamics(const juce::dsp::AudioBlock<const SampleType>& key, int numSamples)
+{
+	auto anyDynamic = false;
+
+	for (int i = 0; i < DynamicDetector::numBands; ++i)
+	{
+		const auto pos = dynamicBands[(size_t) i];
+		const auto range = options.dynamicRanges[(size_t) i];
+
+		//a band turning static drops its offset and, at 0 dB, leaves the cascade
+		if ((range != 0.0f) != bandDynamic[pos])
+		{
+			bandDynamic[pos] = range != 0.0f;
+			dynamicGainDB[pos] = 0.0f;
+			updateBandCoefficients(pos);
+		}
+
+		//tuned to where a ramp is heading, so the detector isn't retuned every block of it
+		if (bandDynamic[pos])
+			detector.setBand(i, smoothers[pos].freq.getTargetValue(), smoothers[pos].q.getTargetValue());
+
+		anyDynamic = anyDynamic || bandDynamic[pos];
+	}
+
+	if (! anyDynamic)
+		return false;
+
+	detector.setTimes(options.dynamicAttackMs, options.dynamicReleaseMs);
+
+	const auto keySamples = juce::jmin(numSamples, (int) key.getNumSamples(), (int) dynamicKey.size());
+	const auto numKeyChannels = (int) key.getNumChannels();
+	const auto scale = 1.0f / (float) juce::jmax(1, numKeyChannels);
+
+	jassert(keySamples == numSamples);
+	std::fill(dynamicKey.begin(), dynamicKey.begin() + keySamples, 0.0f);
+
+	for (int ch = 0; ch < numKeyChannels; ++ch)
+	{
+		const auto* source = key.getChannelPointer((size_t) ch);
+
+		for (int i = 0; i < keySamples; ++i)
+			dynamicKey[(size_t) i] += (float) source[i] * scale;
+	}
+
+	return true;
+}
+
+void EQEngine::updateDynamics(int start, int length)
+{
+	detector.process(dynamicKey.data() + start, juce::jmin(length, (int) dynamicKey.size() - start));
+
+	for (int i = 0; i < DynamicDetector::numBands; ++i)
+	{
+		const auto pos = dynamicBands[(size_t) i];
+
+		if (! bandDynamic[pos])
+			continue;
+
+		dynamicGainDB[pos] = getDynamicGain(detector.getLevelDecibels(i), options.dynamicThresholds[(size_t) i], options.dynamicRanges[(size_t) i]);
+		updateBandCoefficients(pos);
+	}
+}
+
+float EQEngine::getDynamicGain(float levelDB, float thresholdDB, float rangeDB) noexcept
+{
+	const auto change = juce::jmax(0.0f, levelDB - thresholdDB) * dynamicSlope;
+	return rangeDB > 0.0f ? juce::jmin(rangeDB, change) : juce::jmax(rangeDB, -change);
+}
+
+//==============================================================================
+void EQEngine::setOversamplingFactor(int factor)
+{
+	//anything but 2x and 4x runs at the host rate
+	oversamplingFactor = factor == 2 || factor == 4 ? factor : 1;
+
+	if (oversamplingFactor > 1 && oversamplers[(size_t) getOversamplingIndex()] != nullptr)
+		oversamplers[(size_t) getOversamplingIndex()]->reset();
+
+	//every band is routed again, and the ones that stay oversampled restart from silence at the new rate
+	oversampledCascade.reset();
+	pendingBands.fill(true);
+}
+
+bool EQEngine::shouldOversample(float freq) const noexcept
+{
+	return oversamplingFactor > 1 && freq > setup.sampleRate * oversampleAboveFraction;
+}
+
+const CoefficientTables& EQEngine::getTables(ChainPos pos) const noexcept
+{
+	return bandRoute[pos] == Route::Oversampled ? *oversampledTables[(size_t) getOversamplingIndex()] : *tables;
+}
+
+CutFilterDesigns& EQEngine::getCutDesigns(ChainPos pos) noexcept
+{
+	return bandRoute[pos] == Route::Oversampled ? oversampledCutDesigns[(size_t) getOversamplingIndex()] : cutDesigns;
+}
+
+template <typename CascadeType, typename SampleType>
+void EQEngine::processCascade(CascadeType& cascadeToUse, const juce::dsp::AudioBlock<SampleType>& block)
+{
+	if (workerPool != nullptr && options.nonRealtime && (int) block.getNumSamples() >= minParallelSamples)
+		cascadeToUse.process(block, *workerPool);
+	else
+		cascadeToUse.process(block);
+}
+
+EQEngine::Route EQEngine::getRoute(float freq) const noexcept
+{
+	if (shouldOversample(freq))
+		return Route::Oversampled;
+
+	if (setup.doublePrecision || (mixedPrecision && freq < setup.sampleRate * doubleBelowFraction))
+		return Route::Double;
+
+	return Route::Single;
+}
+
+EQCascade<float>& EQEngine::getFloatCascade(ChainPos pos) noexcept
+{
+	jassert(bandRoute[pos] != Route::Double);
+	return bandRoute[pos] == Route::Oversampled ? oversampledCascade : cascade;
+}
+
+void EQEngine::enableStage(ChainPos pos, int stage, bool shouldBeEnabled) noexcept
+{
+	//a stage only ever runs in the cascade its band is routed to, moving it crossfades out of one and into the other
+	const auto route = bandRoute[pos];
+
+	cascade.setStageEnabled(stage, shouldBeEnabled && route == Route::Single);
+	doubleCascade.setStageEnabled(stage, shouldBeEnabled && route == Route::Double);
+	oversampledCascade.setStageEnabled(stage, shouldBeEnabled && route == Route::Oversampled);
+}
+
+std::array<double, 6> EQEngine::makePreciseBandCoefficients(ChainPos pos, float freq, float q, float gainDB) const
+{
+	using Coefficients = juce::dsp::IIR::ArrayCoefficients<double>;
+	const auto gain = juce::Decibels::decibelsToGain((double) gainDB);
+
+	switch (pos)
+	{
+	case LowShelf:
+		return Coefficients::makeLowShelf(setup.sampleRate, (double) freq, (double) q, gain);
+	case HiShelf:
+		return Coefficients::makeHighShelf(setup.sampleRate, (double) freq, (double) q, gain);
+	default:
+		return Coefficients::makePeakFilter(setup.sampleRate, (double) freq, (double) q, gain);
+	}
+}
+
+std::array<double, 6> EQEngine::makePreciseCutSection(CutFilterDesigns::Type type, float freq, int order, int section) const
+{
+	using Coefficients = juce::dsp::IIR::ArrayCoefficients<double>;
+	const auto corner = juce::jmin((double) freq, setup.sampleRate * 0.49);
+	const auto q = CutFilterDesigns::getSectionQ(order, section);
+
+	return type == CutFilterDesigns::Type::HighPass ? Coefficients::makeHighPass(setup.sampleRate, corner, q)
+													: Coefficients::makeLowPass(setup.sampleRate, corner, q);
+}
+
+template <typename SampleType, typename Function>
+void EQEngine::processInSinglePrecision(const juce::dsp::AudioBlock<SampleType>& block, Function&& process)
+{
+	if constexpr (std::is_same_v<SampleType, float>)
+	{
+		process(block);
+	}
+	else
+	{
+		const auto numChannels = juce::jmin((int) block.getNumChannels(), singlePrecisionScratch.getNumChannels());
+		const auto numSamples = (int) block.getNumSamples();
+
+		for (int ch = 0; ch < numChannels; ++ch)
+		{
+			const auto* source = block.getChannelPointer((size_t) ch);
+			auto* dest = singlePrecisionScratch.getWritePointer(ch);
+
+			for (int i = 0; i < numSamples; ++i)
+				dest[i] = (float) source[i];
+		}
+
+		process(juce::dsp::AudioBlock<float>(singlePrecisionScratch).getSubsetChannelBlock(0, (size_t) numChannels).getSubBlock(0, (size_t) numSamples));
+
+		for (int ch = 0; ch < numChannels; ++ch)
+		{
+			const auto* source = singlePrecisionScratch.getReadPointer(ch);
+			auto* dest = block.getChannelPointer((size_t) ch);
+
+			for (int i = 0; i < numSamples; ++i)
+				dest[i] = (SampleType) source[i];
+		}
+	}
+}
+
+//==============================================================================
+LinearPhaseEQ::Curve EQEngine::makeLinearPhaseCurve(const ChainSettings& settings, int firLength)
+{
+	//the stages the cascade would run at the host rate, taken at their targets rather than mid ramp
+	LinearPhaseEQ::Curve curve;
+	curve.firLength = firLength;
+
+	const auto addCut = [&](CutFilterDesigns::Type type, float freq, Slope slope)
+	{
+		const auto& design = cutDesigns.getDesign(type, freq, 2 * (slope + 1));
+
+		for (int i = 0; i < design.numSections; ++i)
+			curve.stages[(size_t) curve.numStages++] = design.sections[(size_t) i];
+	};
+
+	if (settings.lowCutFreq > CoefficientTables::minFreq)
+		addCut(CutFilterDesigns::Type::HighPass, settings.lowCutFreq, settings.lowCutSlope);
+
+	for (auto pos : { ChainPos::LowShelf, ChainPos::LowMidPeak, ChainPos::MidPeak, ChainPos::HiShelf })
+	{
+		const auto band = getBandSettings(settings, pos);
+
+		if (band.gainDB == 0.0f)
+			continue;
+
+		curve.stages[(size_t) curve.numStages++] = pos == LowShelf ? tables->makeLowShelf(band.freq, band.q, band.gainDB)
+												 : pos == HiShelf ? tables->makeHighShelf(band.freq, band.q, band.gainDB)
+																  : tables->makePeakFilter(band.freq, band.q, band.gainDB);
+	}
+
+	if (settings.hiCutFreq < CoefficientTables::maxFreq)
+		addCut(CutFilterDesigns::Type::LowPass, settings.hiCutFreq, settings.highCutSlope);
+
+	return curve;
+}
+
+int EQEngine::stageIndex(ChainPos pos)
+{
+	switch (pos)
+	{
+	case LowCut:
+		return 0;
+	case HiCut:
+		return cutStages + 4;
+	default:
+		return cutStages + (pos - LowShelf);
+	}
+}
@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    The EQ's signal path on its own: bands, cascades, oversampling, linear
+    phase and dynamics, with no parameters, buses or host around it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EQCascade.h"
+#include "CoefficientTables.h"
+#include "CutFilterDesigns.h"
+#include "LinearPhaseEQ.h"
+#include "DynamicDetector.h"
+
+
+enum Slope
+	{
+		Slope12,
+		Slope24,
+		Slope36,
+		Slope48
+	};
+
+struct ChainSettings
+{
+	float lowShelfQ{1.0f};
+	float lowMidQ{1.0f};
+	float midQ{1.0f};
+	float hiShelfQ{1.0f};
+	float lowShelfGainDB{0};
+	float lowMidGainDB{0};
+	float midGainDB{0};
+	float hiShelfGainDB{0};
+	float lowCutFreq{0};
+	float hiCutFreq{0};
+	float lowShelfFreq{0};
+	float lowMidFreq{0};
+	float midFreq{0};
+	float hiShelfFreq{0};
+	Slope lowCutSlope{Slope::Slope12};
+	Slope highCutSlope{Slope::Slope12};
+};
+
+//==============================================================================
+/**
+	Turns ChainSettings into running filters and processes audio through them.
+	It owns the cascades, coefficient tables, oversamplers, the linear phase FIR
+	and the dynamic detector, and knows nothing about parameters or buses: the
+	plugin feeds it from its APVTS every block, the batch tool once from a preset.
+
+	Apart from the static helpers and startDesigner(), every call belongs to the
+	thread that processes audio, or to a time when nothing is processing. New
+	settings and options are only stored when they're handed over and take effect
+	at the start of the next process() call.
+*/
+class EQEngine
+{
+public:
+	//Low Cut > Low Shelf > Low Mid Peak > Mid Peak > Hi Shelf > Hi Cut
+	enum ChainPos
+	{
+		LowCut,
+		LowShelf,
+		LowMidPeak,
+		MidPeak,
+		HiShelf,
+		HiCut,
+		NumChainPos
+	};
+
+	//stereo modes: linked runs every band on every channel, mid/side and left/right put each band on one or both of a pair
+	enum class StereoMode
+	{
+		Linked,
+		MidSide,
+		LeftRight
+	};
+
+	/** What prepare() sizes everything for. */
+	struct Setup
+	{
+		double sampleRate = 44100.0;
+		int maximumBlockSize = 512;
+		int numChannels = 2;
+
+		//double precision audio runs every band at the host rate in the double cascade
+		bool doublePrecision = false;
+
+		bool operator== (const Setup& other) const noexcept
+		{
+			return sampleRate == other.sampleRate && maximumBlockSize == other.maximumBlockSize
+				&& numChannels == other.numChannels && doublePrecision == other.doublePrecision;
+		}
+
+		bool operator!= (const Setup& other) const noexcept { return ! operator== (other); }
+	};
+
+	/** Everything besides the curve that changes how the bands run. */
+	struct Options
+	{
+		//samples between coefficient rebuilds of a ramping band, 0 applies every change to the whole block
+		int smoothingStep = 32;
+		int oversamplingFactor = 1;
+		bool mixedPrecision = false;
+
+		StereoMode stereoMode = StereoMode::Linked;
+
+		//the channel of the pair each band runs on outside linked mode, -1 for both
+		std::array<int, NumChainPos> bandChannels { -1, -1, -1, -1, -1, -1 };
+
+		bool linearPhase = false;
+		int firLength = LinearPhaseEQ::minFirLength * 2;
+
+		//per dynamic band, in the order of dynamicBands, a range of 0 dB keeps the band static
+		std::array<float, DynamicDetector::numBands> dynamicRanges {}, dynamicThresholds {};
+		float dynamicAttackMs = 5.0f, dynamicReleaseMs = 150.0f;
+
+		//wide buses spread their channel groups over a worker pool, only when not running in real time
+		bool nonRealtime = false;
+	};
+
+	using BandFlags = std::array<bool, NumChainPos>;
+
+	//detector lane of each band that can be dynamic
+	static constexpr std::array<ChainPos, DynamicDetector::numBands> dynamicBands { LowShelf, LowMidPeak, MidPeak, HiShelf };
+
+	EQEngine() = default;
+
+	/** Builds everything for the setup, with every band starting at its settings rather than ramping in. */
+	void prepare(const Setup& newSetup, const ChainSettings& settings, const Options& newOptions);
+
+	/** Frees the filters, tables and oversamplers. process() passes audio through untouched until the next prepare(). */
+	void release();
+
+	/** Clears what the filters have heard and nothing else. */
+	void reset();
+
+	bool isPrepared() const noexcept { return prepared; }
+	const Setup& getSetup() const noexcept { return setup; }
+
+	/** New curve settings. Only the bands flagged in changed move to them, all of them when jump is set, and then without a ramp. */
+	void setSettings(const ChainSettings& settings, const BandFlags& changed, bool jump);
+
+	void setOptions(const Options& newOptions);
+	const Options& getOptions() const noexcept { return options; }
+
+	/** Filters the block in place. The key drives the dynamic bands and is read before the block is touched, so it may be the block itself. */
+	void process(const juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<const float>& key);
+	void process(const juce::dsp::AudioBlock<double>& block, const juce::dsp::AudioBlock<const double>& key);
+
+	/** The delay of the linear phase FIR or of the oversamplers, as things stand after the last prepare() or process(). */
+	int getLatencySamples() const;
+
+	/** True when linear phase is in use and its designer thread still has to be started, see startDesigner(). */
+	bool needsDesigner() const noexcept;
+
+	/** Starts the linear phase designer thread. Safe from any thread between prepare() and release(), plugins call it from the message thread. */
+	void startDesigner();
+
+	/** Returns the coefficient rebuilds since the last call. */
+	int takeCoefficientUpdates() noexcept { return std::exchange(coefficientUpdates, 0); }
+
+	/** How long the minimum phase cascade keeps ringing after the input stops, to -60 dB. */
+	static double getRingSeconds(const ChainSettings& settings, const Options& options);
+
+private:
+	template <typename SampleType>
+	void processSamples(const juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<const SampleType>& key);
+
+	void applyOptions();
+	void applyPendingBands();
+	bool consumePending(ChainPos pos);
+
+	void peakFilterUpdate(const ChainSettings& settings);
+	void cutFilterUpdate(const ChainSettings& settings);
+	void shelfFilterUpdate(const ChainSettings& settings);
+	void setCutStages(ChainPos pos, CutFilterDesigns::Type type, float freq, int order, bool active);
+	void setCutTarget(ChainPos pos, float freq, int order, bool active);
+	void updateCutCoefficients(ChainPos pos);
+
+	//peak and shelf bands, and the corners of the cut filters, ramp towards their targets and have their
+	//coefficients rebuilt every smoothing step
+	struct BandSettings
+	{
+		float freq{1000.0f};
+		float q{1.0f};
+		float gainDB{0};
+	};
+
+	struct BandSmoother
+	{
+		juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> freq;
+		juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> q;
+		juce::SmoothedValue<float> gainDB;
+	};
+
+	static constexpr double smoothingTimeSeconds = 0.05;
+
+	static BandSettings getBandSettings(const ChainSettings& settings, ChainPos pos);
+	void setBandTarget(ChainPos pos, const BandSettings& target);
+	void updateBandCoefficients(ChainPos pos);
+
+	bool isSmoothing() const;
+	void advanceSmoothing(int numSamples);
+
+	//peak and shelf bands can follow a band-limited detector, their gain rebuilt every control step of this many samples
+	static constexpr int dynamicStep = 32;
+
+	//dB of gain change per dB the key is over the threshold, until the band has covered its range
+	static constexpr float dynamicSlope = 0.5f;
+
+	template <typename SampleType>
+	bool prepareDynamics(const juce::dsp::AudioBlock<const SampleType>& key, int numSamples);
+	void updateDynamics(int start, int length);
+	static float getDynamicGain(float levelDB, float thresholdDB, float rangeDB) noexcept;
+
+	//the cut filters take up to four biquad stages each, every other band takes one
+	static constexpr int cutStages = 4;
+	static int stageIndex(ChainPos pos);
+
+	EQCascade<float> cascade;
+
+	juce::SharedResourcePointer<CoefficientTableCache> tableCache;
+	std::shared_ptr<const CoefficientTables> tables;
+	CutFilterDesigns cutDesigns;
+
+	//bands with a corner above this fraction of the host rate run in a second cascade at the oversampled rate,
+	//everything below stays at the host rate where the bilinear transform is already accurate
+	static constexpr double oversampleAboveFraction = 0.125;
+	static constexpr int numOversamplingRates = 2;
+
+	void setOversamplingFactor(int factor);
+	bool shouldOversample(float freq) const noexcept;
+	int getOversamplingIndex() const noexcept { return oversamplingFactor == 2 ? 0 : 1; }
+
+	const CoefficientTables& getTables(ChainPos pos) const noexcept;
+	CutFilterDesigns& getCutDesigns(ChainPos pos) noexcept;
+
+	template <typename CascadeType, typename SampleType>
+	void processCascade(CascadeType& cascadeToUse, const juce::dsp::AudioBlock<SampleType>& block);
+
+	//2x and 4x are both made in prepare, so switching between them never allocates
+	EQCascade<float> oversampledCascade;
+	std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, numOversamplingRates> oversamplers;
+	std::array<std::shared_ptr<const CoefficientTables>, numOversamplingRates> oversampledTables;
+	std::array<CutFilterDesigns, numOversamplingRates> oversampledCutDesigns;
+	int oversamplingFactor = 1;
+
+	//bands whose poles sit close to the unit circle run in double precision, in mixed mode those below this
+	//fraction of the host rate and with double precision audio every band that isn't oversampled
+	static constexpr double doubleBelowFraction = 0.01;
+
+	enum class Route
+	{
+		Single,
+		Double,
+		Oversampled
+	};
+
+	Route getRoute(float freq) const noexcept;
+
+	EQCascade<float>& getFloatCascade(ChainPos pos) noexcept;
+	void enableStage(ChainPos pos, int stage, bool shouldBeEnabled) noexcept;
+
+	std::array<double, 6> makePreciseBandCoefficients(ChainPos pos, float freq, float q, float gainDB) const;
+	std::array<double, 6> makePreciseCutSection(CutFilterDesigns::Type type, float freq, int order, int section) const;
+
+	//oversampling and linear phase only run in single precision, double precision audio goes through them via this copy
+	template <typename SampleType, typename Function>
+	void processInSinglePrecision(const juce::dsp::AudioBlock<SampleType>& block, Function&& process);
+
+	EQCascade<double> doubleCascade;
+	juce::AudioBuffer<float> singlePrecisionScratch;
+	bool mixedPrecision = false;
+
+	//which cascade each band currently runs in
+	std::array<Route, NumChainPos> bandRoute {};
+
+	void updateStereoMode();
+
+	template <typename CascadeType, typename CoefficientType>
+	void setStageCoefficients(CascadeType& target, ChainPos pos, int stage, const std::array<CoefficientType, 6>& c) noexcept;
+
+	bool midSide = false;
+
+	//the channel of the pair each band runs on, -1 for all of them
+	std::array<int, NumChainPos> bandChannel { -1, -1, -1, -1, -1, -1 };
+
+	//linear phase mode replaces the cascades with one long FIR of the same curve, redesigned whenever the settings move
+	LinearPhaseEQ::Curve makeLinearPhaseCurve(const ChainSettings& settings, int firLength);
+
+	LinearPhaseEQ linearPhase;
+	bool linearPhaseActive = false;
+	bool curveChanged = false;
+	int designedFirLength = 0;
+
+	//only created for non-realtime rendering, below this many samples a segment isn't worth handing out
+	static constexpr int minParallelSamples = 256;
+	std::unique_ptr<ChannelWorkerPool> workerPool;
+
+	std::array<BandSmoother, NumChainPos> smoothers;
+
+	//the cut filters only smooth their frequency, their slope and on/off state apply straight away
+	std::array<int, NumChainPos> cutOrder {};
+	std::array<bool, NumChainPos> cutActive {};
+
+	//the mono key for the block, and each band's current dynamic gain offset
+	DynamicDetector detector;
+	std::vector<float> dynamicKey;
+	std::array<float, NumChainPos> dynamicGainDB {};
+	std::array<bool, NumChainPos> bandDynamic {};
+
+	//bands to rebuild from currentSettings at the next block, from setSettings or from an option that moved them
+	BandFlags pendingBands {};
+	ChainSettings currentSettings;
+	Options options;
+	bool snapBands = false;
+
+	Setup setup;
+	bool prepared = false;
+	int coefficientUpdates = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EQEngine)
+};
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    Linear phase version of the EQ curve, designed in the background and run
+    through a partitioned convolver.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEQ.h"
+
+//==============================================================================
+LinearPhaseEQ::LinearPhaseEQ()
+	: juce::Thread("EQ Linear Phase Designer")
+{
+}
+
+LinearPhaseEQ::~LinearPhaseEQ()
+{
+	stopThread(1000);
+}
+
+void LinearPhaseEQ::prepare(const juce::dsp::ProcessSpec& spec)
+{
+	stopThread(1000);
+
+	//long partitions are cheaper per sample, and next to the FIR's own delay their latency hardly matters
+	const auto partitionSize = juce::jlimit(512, 4096, juce::nextPowerOfTwo((int) spec.maximumBlockSize));
+	convolver.prepare(partitionSize, (int) spec.numChannels);
+
+	//a curve queued before the stop is stale, and nothing may be left for the designer while designNow() runs
+	requests.update();
+}
+
+void LinearPhaseEQ::startDesigner()
+{
+	if (! isThreadRunning())
+		startThread();
+}
+
+void LinearPhaseEQ::release()
+{
+	stopThread(1000);
+	convolver.prepare(0, 0);
+
+	for (auto* buffer : { &spectrum, &window, &impulse })
+		std::vector<float>().swap(*buffer);
+}
+
+void LinearPhaseEQ::designNow(const Curve& curve)
+{
+	design(curve);
+}
+
+void LinearPhaseEQ::requestDesign(const Curve& curve) noexcept
+{
+	requests.getWriteBuffer() = curve;
+	requests.publish();
+
+	//only happens when the curve changes, and the designer is almost always asleep, so the event's lock is uncontended
+	notify();
+}
+
+void LinearPhaseEQ::run()
+{
+	while (! threadShouldExit())
+	{
+		if (requests.update())
+			design(requests.read());
+
+		wait(convolver.releaseRetired() ? releaseIntervalMs : -1);
+	}
+}
+
+void LinearPhaseEQ::design(const Curve& curve)
+{
+	const auto length = curve.firLength;
+	jassert(juce::isPowerOfTwo(length) && length >= minFirLength && length <= maxFirLength);
+
+	//one tap short of the grid size, so the FIR is symmetric about a whole sample
+	const auto numTaps = length - 1;
+	const auto centre = length / 2 - 1;
+
+	juce::dsp::FFT fft(juce::roundToInt(std::log2(length)));
+	spectrum.assign((size_t) (2 * length), 0.0f);
+
+	//combined magnitude of every stage on the FFT grid, with zero phase
+	for (int bin = 0; bin <= length / 2; ++bin)
+	{
+		const auto w = juce::MathConstants<double>::twoPi * bin / length;
+		const auto cos1 = std::cos(w), sin1 = std::sin(w);
+		const auto cos2 = std::cos(2.0 * w), sin2 = std::sin(2.0 * w);
+
+		auto magnitudeSquared = 1.0;
+
+		for (int i = 0; i < curve.numStages; ++i)
+		{
+			const auto& c = curve.stages[(size_t) i];
+
+			const auto numRe = c[0] + c[1] * cos1 + c[2] * cos2;
+			const auto numIm = c[1] * sin1 + c[2] * sin2;
+			const auto denRe = c[3] + c[4] * cos1 + c[5] * cos2;
+			const auto denIm = c[4] * sin1 + c[5] * sin2;
+
+			magnitudeSquared *= (numRe * numRe + numIm * numIm) / (denRe * denRe + denIm * denIm);
+		}
+
+		spectrum[(size_t) (2 * bin)] = (float) std::sqrt(magnitudeSquared);
+	}
+
+	fft.performRealOnlyInverseTransform(spectrum.data());
+
+	//the zero phase impulse wraps around sample 0, rotate it to the centre and window off the ends
+	window.resize((size_t) numTaps);
+	impulse.resize((size_t) numTaps);
+	juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t) numTaps,
+															 juce::dsp::WindowingFunction<float>::blackmanHarris, false);
+
+	for (int n = 0; n < numTaps; ++n)
+		impulse[(size_t) n] = spectrum[(size_t) ((n - centre + length) % length)] * window[(size_t) n];
+
+	convolver.setFilter(convolver.makeFilter(impulse.data(), numTaps));
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    Linear phase version of the EQ curve, designed in the background and run
+    through a partitioned convolver.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+#include "TripleBuffer.h"
+
+//==============================================================================
+/**
+	Reproduces the magnitude response of a set of biquads with a symmetric FIR, so
+	every frequency is delayed by the same amount. The combined magnitude is
+	sampled on an FFT grid the size of the FIR, turned into a zero phase impulse,
+	centred and windowed.
+
+	The audio thread only queues the curve it wants. A background thread designs
+	the FIR and hands it to the PartitionedConvolver, which crossfades to it. While
+	a design is in progress the previous FIR keeps playing, and curves queued in
+	the meantime collapse into the latest one.
+*/
+class LinearPhaseEQ : private juce::Thread
+{
+public:
+	static constexpr int maxStages = 12;
+	static constexpr int minFirLength = 8192;
+	static constexpr int maxFirLength = 65536;
+
+	/** The curve to reproduce: biquads as unnormalised { b0, b1, b2, a0, a1, a2 }, and a power of two FIR length. */
+	struct Curve
+	{
+		std::array<std::array<float, 6>, maxStages> stages {};
+		int numStages = 0;
+		int firLength = minFirLength;
+	};
+
+	LinearPhaseEQ();
+	~LinearPhaseEQ() override;
+
+	/** Sizes the convolver for the block size and channel count. Stops the designer, which stays stopped until startDesigner(). */
+	void prepare(const juce::dsp::ProcessSpec& spec);
+
+	/**
+		Message thread: starts the background designer if it isn't running yet. Instances that
+		never use linear phase never start it. Curves requested before it starts are designed
+		as soon as it does.
+	*/
+	void startDesigner();
+	bool isDesignerRunning() const noexcept { return isThreadRunning(); }
+
+	/** Stops the designer and frees the convolver and design scratch, until the next prepare(). */
+	void release();
+
+	/** Designs a curve on the calling thread, so playback can start with it. Only call between prepare() and startDesigner(). */
+	void designNow(const Curve& curve);
+
+	/** Total delay for a FIR length: the centre tap plus the convolver's partition. */
+	int getLatencySamples(int firLength) const noexcept { return convolver.getLatencySamples() + firLength / 2 - 1; }
+
+	/** Audio thread: queues a curve for the designer, replacing any that hasn't been started yet. */
+	void requestDesign(const Curve& curve) noexcept;
+
+	void reset() noexcept { convolver.reset(); }
+	void process(const juce::dsp::AudioBlock<float>& block) noexcept { convolver.process(block); }
+
+private:
+	void run() override;
+	void design(const Curve& curve);
+
+	//how often to check back while the convolver still holds a filter that has to be freed here
+	static constexpr int releaseIntervalMs = 10;
+
+	TripleBuffer<Curve> requests;
+	PartitionedConvolver convolver;
+
+	//designer scratch, only touched by whichever thread is designing
+	std::vector<float> spectrum, window, impulse;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinearPhaseEQ)
+};
@@ -0,0 +1,336 @@
+/*
+  ==============================================================================
+
+    Uniformly partitioned FFT convolution for long FIR filters.
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+//==============================================================================
+PartitionedConvolver::Filter::Filter(const float* impulse, int length, int partitionSize, const juce::dsp::FFT& fft)
+	: numPartitions(juce::jmax(1, (length + partitionSize - 1) / partitionSize)),
+	  numBins(partitionSize + 1),
+	  re((size_t) (numPartitions * numBins)),
+	  im((size_t) (numPartitions * numBins))
+{
+	jassert(fft.getSize() == 2 * partitionSize);
+
+	std::vector<float> buffer((size_t) (4 * partitionSize));
+
+	//each partition is zero padded to twice its length, so the overlap-save product doesn't wrap around
+	for (int p = 0; p < numPartitions; ++p)
+	{
+		const auto start = p * partitionSize;
+		const auto count = juce::jmin(partitionSize, length - start);
+
+		std::fill(buffer.begin(), buffer.end(), 0.0f);
+		std::copy(impulse + start, impulse + start + count, buffer.begin());
+
+		fft.performRealOnlyForwardTransform(buffer.data(), true);
+
+		for (int bin = 0; bin < numBins; ++bin)
+		{
+			re[(size_t) (p * numBins + bin)] = buffer[(size_t) (2 * bin)];
+			im[(size_t) (p * numBins + bin)] = buffer[(size_t) (2 * bin + 1)];
+		}
+	}
+}
+
+//==============================================================================
+PartitionedConvolver::State::State(int channels, int bins, int slots)
+	: numChannels(channels), numBins(bins), capacity(slots),
+	  re((size_t) (channels * slots * bins)), im((size_t) (channels * slots * bins))
+{
+}
+
+void PartitionedConvolver::State::copyHistoryFrom(State& other) noexcept
+{
+	//slot k behind the head holds the input from k partitions ago, keep that ordering in the bigger line
+	const auto slots = juce::jmin(capacity, other.capacity);
+	head = 0;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+		for (int k = 0; k < slots; ++k)
+		{
+			const auto from = (other.head - k + other.capacity) % other.capacity;
+			const auto to = (capacity - k) % capacity;
+
+			std::copy(other.getRe(channel, from), other.getRe(channel, from) + numBins, getRe(channel, to));
+			std::copy(other.getIm(channel, from), other.getIm(channel, from) + numBins, getIm(channel, to));
+		}
+}
+
+void PartitionedConvolver::State::clear() noexcept
+{
+	std::fill(re.begin(), re.end(), 0.0f);
+	std::fill(im.begin(), im.end(), 0.0f);
+	head = 0;
+}
+
+//==============================================================================
+PartitionedConvolver::~PartitionedConvolver()
+{
+	prepare(0, 0);
+}
+
+void PartitionedConvolver::prepare(int newPartitionSize, int newNumChannels)
+{
+	delete pending.exchange(nullptr);
+	delete retired.exchange(nullptr);
+	delete active;
+	delete fading;
+	active = fading = nullptr;
+	crossfading = false;
+	publishedCapacity = liveUpdates = 0;
+
+	partitionSize = newPartitionSize;
+	numChannels = newNumChannels;
+	numBins = partitionSize + 1;
+	position = 0;
+
+	if (partitionSize <= 0)
+	{
+		fft.reset();
+		filterFFT.reset();
+
+		for (auto* buffer : { &input, &output, &history, &fftBuffer, &accRe, &accIm })
+			std::vector<float>().swap(*buffer);
+
+		return;
+	}
+
+	jassert(juce::isPowerOfTwo(partitionSize));
+
+	const auto order = juce::roundToInt(std::log2(partitionSize)) + 1;
+	fft = std::make_unique<juce::dsp::FFT>(order);
+	filterFFT = std::make_unique<juce::dsp::FFT>(order);
+
+	input.assign((size_t) (numChannels * partitionSize), 0.0f);
+	output.assign((size_t) (numChannels * partitionSize), 0.0f);
+	history.assign((size_t) (numChannels * partitionSize), 0.0f);
+	fftBuffer.assign((size_t) (4 * partitionSize), 0.0f);
+	accRe.assign((size_t) numBins, 0.0f);
+	accIm.assign((size_t) numBins, 0.0f);
+}
+
+std::unique_ptr<PartitionedConvolver::Filter> PartitionedConvolver::makeFilter(const float* impulse, int length) const
+{
+	jassert(filterFFT != nullptr);
+	return std::make_unique<Filter>(impulse, length, partitionSize, *filterFFT);
+}
+
+void PartitionedConvolver::setFilter(std::unique_ptr<Filter> filter)
+{
+	releaseRetired();
+
+	auto update = std::make_unique<Update>();
+
+	//the delay line has to reach back as far as the longest filter, it's replaced here and never on the audio thread
+	if (filter->getNumPartitions() > publishedCapacity)
+	{
+		publishedCapacity = filter->getNumPartitions();
+		update->state = std::make_unique<State>(numChannels, numBins, publishedCapacity);
+	}
+
+	update->filter = std::move(filter);
+
+	//a filter the audio thread never picked up is replaced, but a delay line it was bringing along is passed on
+	std::unique_ptr<Update> unclaimed(pending.exchange(nullptr, std::memory_order_acq_rel));
+
+	if (unclaimed != nullptr)
+	{
+		if (update->state == nullptr)
+			update->state = std::move(unclaimed->state);
+
+		--liveUpdates;
+	}
+
+	pending.store(update.release(), std::memory_order_release);
+	++liveUpdates;
+}
+
+bool PartitionedConvolver::releaseRetired()
+{
+	if (auto* done = retired.exchange(nullptr, std::memory_order_acq_rel))
+	{
+		delete done;
+		--liveUpdates;
+	}
+
+	//one update is always the one in use, anything beyond that is on its way in or out
+	return liveUpdates > 1;
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+	std::fill(input.begin(), input.end(), 0.0f);
+	std::fill(output.begin(), output.end(), 0.0f);
+	std::fill(history.begin(), history.end(), 0.0f);
+	position = 0;
+
+	if (active != nullptr)
+		active->state->clear();
+}
+
+void PartitionedConvolver::process(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+	const auto numSamples = (int) block.getNumSamples();
+	const auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numChannels);
+
+	if (partitionSize <= 0)
+		return;
+
+	for (int offset = 0; offset < numSamples;)
+	{
+		const auto count = juce::jmin(numSamples - offset, partitionSize - position);
+
+		for (int channel = 0; channel < channelsToProcess; ++channel)
+		{
+			auto* data = block.getChannelPointer((size_t) channel) + offset;
+			auto* in = input.data() + channel * partitionSize + position;
+			const auto* out = output.data() + channel * partitionSize + position;
+
+			for (int i = 0; i < count; ++i)
+			{
+				in[i] = data[i];
+				data[i] = out[i];
+			}
+		}
+
+		position += count;
+		offset += count;
+
+		if (position == partitionSize)
+		{
+			processPartition();
+			position = 0;
+		}
+	}
+}
+
+//==============================================================================
+void PartitionedConvolver::swapFilters() noexcept
+{
+	//one hand-off at a time: the previous filter has to be faded out and collected before the next comes in
+	if (crossfading || retired.load(std::memory_order_acquire) != nullptr)
+		return;
+
+	auto* next = pending.exchange(nullptr, std::memory_order_acq_rel);
+
+	if (next == nullptr)
+		return;
+
+	//the first update always brings a delay line, later ones either reuse the current one or bring a longer copy
+	if (next->state == nullptr)
+		next->state = std::move(active->state);
+	else if (active != nullptr)
+		next->state->copyHistoryFrom(*active->state);
+
+	fading = active;
+	active = next;
+	crossfading = true;
+}
+
+void PartitionedConvolver::processPartition() noexcept
+{
+	swapFilters();
+
+	if (active == nullptr)
+		return;
+
+	auto& state = *active->state;
+	state.head = (state.head + 1) % state.capacity;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		auto* in = input.data() + channel * partitionSize;
+		auto* past = history.data() + channel * partitionSize;
+		auto* out = output.data() + channel * partitionSize;
+
+		//overlap-save: transform the previous partition followed by this one
+		std::copy(past, past + partitionSize, fftBuffer.begin());
+		std::copy(in, in + partitionSize, fftBuffer.begin() + partitionSize);
+		std::fill(fftBuffer.begin() + 2 * partitionSize, fftBuffer.end(), 0.0f);
+		std::copy(in, in + partitionSize, past);
+
+		fft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+		auto* slotRe = state.getRe(channel, state.head);
+		auto* slotIm = state.getIm(channel, state.head);
+
+		for (int bin = 0; bin < numBins; ++bin)
+		{
+			slotRe[bin] = fftBuffer[(size_t) (2 * bin)];
+			slotIm[bin] = fftBuffer[(size_t) (2 * bin + 1)];
+		}
+
+		convolve(*active->filter, state, channel, out);
+
+		if (! crossfading)
+			continue;
+
+		//the outgoing filter runs over the same delay line for one partition, or silence when there was none
+		if (fading != nullptr)
+		{
+			convolve(*fading->filter, state, channel, fftBuffer.data());
+
+			for (int i = 0; i < partitionSize; ++i)
+			{
+				const auto gain = (float) (i + 1) / (float) partitionSize;
+				out[i] = fftBuffer[(size_t) i] + gain * (out[i] - fftBuffer[(size_t) i]);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < partitionSize; ++i)
+				out[i] *= (float) (i + 1) / (float) partitionSize;
+		}
+	}
+
+	if (crossfading)
+	{
+		crossfading = false;
+
+		if (fading != nullptr)
+			retired.store(std::exchange(fading, nullptr), std::memory_order_release);
+	}
+}
+
+void PartitionedConvolver::convolve(const Filter& filter, State& state, int channel, float* result) noexcept
+{
+	std::fill(accRe.begin(), accRe.end(), 0.0f);
+	std::fill(accIm.begin(), accIm.end(), 0.0f);
+
+	auto* sumRe = accRe.data();
+	auto* sumIm = accIm.data();
+
+	//partition k of the filter meets the input from k partitions ago
+	for (int k = 0; k < filter.numPartitions; ++k)
+	{
+		const auto slot = (state.head - k + state.capacity) % state.capacity;
+		const auto* xRe = state.getRe(channel, slot);
+		const auto* xIm = state.getIm(channel, slot);
+		const auto* hRe = filter.re.data() + k * numBins;
+		const auto* hIm = filter.im.data() + k * numBins;
+
+		for (int bin = 0; bin < numBins; ++bin)
+		{
+			sumRe[bin] += hRe[bin] * xRe[bin] - hIm[bin] * xIm[bin];
+			sumIm[bin] += hRe[bin] * xIm[bin] + hIm[bin] * xRe[bin];
+		}
+	}
+
+	for (int bin = 0; bin < numBins; ++bin)
+	{
+		fftBuffer[(size_t) (2 * bin)] = sumRe[bin];
+		fftBuffer[(size_t) (2 * bin + 1)] = sumIm[bin];
+	}
+
+	std::fill(fftBuffer.begin() + 2 * numBins, fftBuffer.end(), 0.0f);
+	fft->performRealOnlyInverseTransform(fftBuffer.data());
+
+	//the second half of the circular result is the part free of wrap-around
+	std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + 2 * partitionSize, result);
+}
@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    Uniformly partitioned FFT convolution for long FIR filters.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+	Convolves every channel with the same FIR using uniformly partitioned
+	overlap-save. The FIR is cut into partitions of the partition size, each one
+	transformed once when the filter is made. Per partition of audio the input is
+	transformed once and multiplied against every filter partition in a frequency
+	domain delay line, so the cost grows with the number of partitions rather than
+	with the number of taps.
+
+	Filters are made and handed over from one background thread. The audio thread
+	picks a new filter up at its next partition boundary and crossfades to it over
+	one partition. Nothing on the audio thread locks, allocates or frees: filters
+	the audio thread has finished with are freed by the publishing thread.
+
+	The frequency domain delay line is only allocated once a filter needs it, and
+	only grows, so a convolver that is never given a filter costs next to nothing.
+*/
+class PartitionedConvolver
+{
+public:
+	/** The transformed partitions of one FIR, immutable once made. */
+	class Filter
+	{
+	public:
+		Filter(const float* impulse, int length, int partitionSize, const juce::dsp::FFT& fft);
+
+		int getNumPartitions() const noexcept { return numPartitions; }
+
+	private:
+		friend class PartitionedConvolver;
+
+		int numPartitions = 0, numBins = 0;
+		std::vector<float> re, im;
+
+		JUCE_DECLARE_NON_COPYABLE(Filter)
+	};
+
+	PartitionedConvolver() = default;
+	~PartitionedConvolver();
+
+	/**
+		Sizes the convolver for a power of two partition size, dropping every filter. A size
+		of 0 frees everything it holds. Call with nothing processing or publishing.
+	*/
+	void prepare(int partitionSize, int numChannels);
+
+	int getPartitionSize() const noexcept { return partitionSize; }
+
+	/** Delay added by the partitioning, on top of whatever delay the filter itself has. */
+	int getLatencySamples() const noexcept { return partitionSize; }
+
+	/** Publishing thread: transforms an FIR into a filter for this convolver. */
+	std::unique_ptr<Filter> makeFilter(const float* impulse, int length) const;
+
+	/** Publishing thread: hands a filter to the audio thread. A filter that hasn't been picked up yet is replaced. */
+	void setFilter(std::unique_ptr<Filter> filter);
+
+	/**
+		Publishing thread: frees whatever the audio thread has let go of. Returns true
+		while an earlier filter is still waiting to be let go of, in which case this
+		should be called again shortly.
+	*/
+	bool releaseRetired();
+
+	/** Audio thread: clears the delay line and buffered audio. */
+	void reset() noexcept;
+
+	/** Audio thread: filters the block in place, delayed by getLatencySamples(). Outputs silence until the first filter arrives. */
+	void process(const juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+	//frequency domain delay line of every channel, one transformed input partition per slot
+	struct State
+	{
+		State(int numChannels, int numBins, int capacity);
+
+		float* getRe(int channel, int slot) noexcept { return re.data() + ((size_t) channel * (size_t) capacity + (size_t) slot) * (size_t) numBins; }
+		float* getIm(int channel, int slot) noexcept { return im.data() + ((size_t) channel * (size_t) capacity + (size_t) slot) * (size_t) numBins; }
+
+		void copyHistoryFrom(State& other) noexcept;
+		void clear() noexcept;
+
+		int numChannels, numBins, capacity, head = 0;
+		std::vector<float> re, im;
+	};
+
+	//a filter travels to the audio thread together with a bigger delay line when it needs one
+	struct Update
+	{
+		std::unique_ptr<Filter> filter;
+		std::unique_ptr<State> state;
+	};
+
+	void swapFilters() noexcept;
+	void processPartition() noexcept;
+	void convolve(const Filter& filter, State& state, int channel, float* output) noexcept;
+
+	int partitionSize = 0, numChannels = 0, numBins = 0, position = 0;
+	std::unique_ptr<juce::dsp::FFT> fft, filterFFT;
+
+	//audio thread buffers: the partition being collected, the one being played out, and the one before for overlap-save
+	std::vector<float> input, output, history;
+	std::vector<float> fftBuffer, accRe, accIm;
+
+	std::atomic<Update*> pending { nullptr }, retired { nullptr };
+
+	//audio thread only, freed by the publishing thread once retired
+	Update* active = nullptr;
+	Update* fading = nullptr;
+	bool crossfading = false;
+
+	//publishing thread only
+	int publishedCapacity = 0, liveUpdates = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
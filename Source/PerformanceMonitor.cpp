@@ -0,0 +1,239 @@
+/*
+  ==============================================================================
+
+    Opt-in block timing for the processor, readable from any thread.
+
+  ==============================================================================
+*/
+
+#include "PerformanceMonitor.h"
+
+//==============================================================================
+//one per process, shared by every instance: writes all their readings to a JSON file once a second
+class PerformanceMonitor::Dump : private juce::Thread
+{
+public:
+	Dump()
+		: juce::Thread("EQ Performance Dump")
+	{
+		const auto directory = juce::SystemStats::getEnvironmentVariable("PARAMETRIC_EQ_PERF_DIR", {});
+
+		if (directory.isEmpty())
+			return;
+
+		file = juce::File::getCurrentWorkingDirectory().getChildFile(directory)
+				   .getChildFile("ParametricEQ-" + juce::Uuid().toString().substring(0, 8) + ".json");
+
+		if (file.getParentDirectory().createDirectory())
+			startThread();
+		else
+			file = juce::File();
+	}
+
+	~Dump() override
+	{
+		stopThread(2000);
+		file.deleteFile();
+	}
+
+	bool isActive() const noexcept { return file != juce::File(); }
+
+	void add(PerformanceMonitor* monitor)
+	{
+		const juce::ScopedLock sl(lock);
+		monitors.add(monitor);
+	}
+
+	void remove(PerformanceMonitor* monitor)
+	{
+		const juce::ScopedLock sl(lock);
+		monitors.removeFirstMatchingValue(monitor);
+	}
+
+private:
+	void run() override
+	{
+		while (! threadShouldExit())
+		{
+			juce::Array<juce::var> readings;
+
+			{
+				const juce::ScopedLock sl(lock);
+
+				for (auto* monitor : monitors)
+					readings.add(monitor->getSnapshot().toVar());
+			}
+
+			//written to a temporary file and moved over, so a reader never sees half of it
+			file.replaceWithText(juce::JSON::toString(juce::var(readings)));
+			wait(1000);
+		}
+	}
+
+	juce::File file;
+	juce::CriticalSection lock;
+	juce::Array<PerformanceMonitor*> monitors;
+};
+
+//==============================================================================
+juce::var PerformanceMonitor::Snapshot::toVar() const
+{
+	auto* object = new juce::DynamicObject();
+
+	object->setProperty("name", name);
+	object->setProperty("blocks", (juce::int64) blocks);
+	object->setProperty("samples", (juce::int64) samples);
+	object->setProperty("overloads", (juce::int64) overloads);
+	object->setProperty("coefficientUpdates", (juce::int64) coefficientUpdates);
+	object->setProperty("meanBlockUs", meanBlockUs);
+	object->setProperty("worstBlockUs", worstBlockUs);
+	object->setProperty("p50BlockUs", p50BlockUs);
+	object->setProperty("p99BlockUs", p99BlockUs);
+	object->setProperty("p999BlockUs", p999BlockUs);
+	object->setProperty("cyclesPerSample", cyclesPerSample);
+	object->setProperty("meanLoad", meanLoad);
+	object->setProperty("worstLoad", worstLoad);
+	object->setProperty("activeBands", activeBands);
+
+	return juce::var(object);
+}
+
+//==============================================================================
+PerformanceMonitor::PerformanceMonitor()
+{
+	static std::atomic<int> instanceCount { 0 };
+	name = "Parametric EQ " + juce::String(++instanceCount);
+
+	//an external monitor asked for readings, so every instance reports without anyone opening an editor
+	if (dump->isActive())
+		setEnabled(true);
+
+	dump->add(this);
+}
+
+PerformanceMonitor::~PerformanceMonitor()
+{
+	dump->remove(this);
+}
+
+void PerformanceMonitor::setName(const juce::String& newName)
+{
+	const juce::ScopedLock sl(nameLock);
+	name = newName;
+}
+
+PerformanceMonitor::Snapshot PerformanceMonitor::getSnapshot() const
+{
+	Snapshot snapshot;
+
+	{
+		const juce::ScopedLock sl(nameLock);
+		snapshot.name = name;
+	}
+
+	std::array<juce::uint32, numBuckets> counts;
+	juce::uint64 counted = 0;
+
+	for (size_t i = 0; i < counts.size(); ++i)
+		counted += counts[i] = buckets[i].load(std::memory_order_relaxed);
+
+	snapshot.blocks = blocks.load(std::memory_order_relaxed);
+	snapshot.samples = samples.load(std::memory_order_relaxed);
+	snapshot.overloads = overloads.load(std::memory_order_relaxed);
+	snapshot.coefficientUpdates = coefficientUpdates.load(std::memory_order_relaxed);
+	snapshot.worstBlockUs = (double) worstNs.load(std::memory_order_relaxed) / 1000.0;
+	snapshot.worstLoad = worstLoad.load(std::memory_order_relaxed);
+	snapshot.activeBands = activeBands.load(std::memory_order_relaxed);
+
+	if (snapshot.blocks > 0)
+	{
+		snapshot.meanBlockUs = (double) totalNs.load(std::memory_order_relaxed) / 1000.0 / (double) snapshot.blocks;
+		snapshot.meanLoad = totalLoad.load(std::memory_order_relaxed) / (double) snapshot.blocks;
+	}
+
+	if (snapshot.samples > 0)
+		snapshot.cyclesPerSample = (double) totalCycles.load(std::memory_order_relaxed) / (double) snapshot.samples;
+
+	snapshot.p50BlockUs = getPercentileUs(counts, counted, 0.5);
+	snapshot.p99BlockUs = getPercentileUs(counts, counted, 0.99);
+	snapshot.p999BlockUs = getPercentileUs(counts, counted, 0.999);
+
+	return snapshot;
+}
+
+//==============================================================================
+int PerformanceMonitor::getBucket(juce::uint64 ns) noexcept
+{
+	const auto clamped = (juce::uint32) juce::jlimit((juce::uint64) 1 << minOctave, (juce::uint64) 0xffffffff, ns);
+	const auto octave = juce::findHighestSetBit(clamped);
+	const auto subBucket = (int) (clamped >> (octave - subBucketBits)) & ((1 << subBucketBits) - 1);
+
+	return ((octave - minOctave) << subBucketBits) + subBucket;
+}
+
+double PerformanceMonitor::getBucketUpperUs(int bucket) noexcept
+{
+	const auto octave = minOctave + (bucket >> subBucketBits);
+	const auto subBucket = bucket & ((1 << subBucketBits) - 1);
+
+	return std::ldexp((double) ((1 << subBucketBits) + subBucket + 1), octave - subBucketBits) / 1000.0;
+}
+
+double PerformanceMonitor::getPercentileUs(const std::array<juce::uint32, numBuckets>& counts, juce::uint64 total, double fraction) const noexcept
+{
+	if (total == 0)
+		return 0.0;
+
+	//the bucket's upper edge, so a percentile is never reported better than it was
+	const auto rank = (juce::uint64) std::ceil(fraction * (double) total);
+	juce::uint64 seen = 0;
+
+	for (int i = 0; i < numBuckets; ++i)
+	{
+		seen += counts[(size_t) i];
+
+		if (seen >= rank)
+			return getBucketUpperUs(i);
+	}
+
+	return getBucketUpperUs(numBuckets - 1);
+}
+
+void PerformanceMonitor::record(juce::uint64 ns, juce::uint64 cycles, int numSamples, int bandCount) noexcept
+{
+	if (resetRequested.load(std::memory_order_relaxed) && resetRequested.exchange(false))
+		clear();
+
+	const auto load = (double) ns * 1.0e-9 * sampleRate.load(std::memory_order_relaxed) / juce::jmax(1, numSamples);
+
+	add(buckets[(size_t) getBucket(ns)], (juce::uint32) 1);
+	add(blocks, (juce::uint64) 1);
+	add(samples, (juce::uint64) numSamples);
+	add(totalNs, ns);
+	add(totalCycles, cycles);
+	add(totalLoad, load);
+	add(coefficientUpdates, pendingUpdates);
+
+	if (load > 1.0)
+		add(overloads, (juce::uint64) 1);
+
+	if (ns > worstNs.load(std::memory_order_relaxed))
+		worstNs.store(ns, std::memory_order_relaxed);
+
+	if (load > worstLoad.load(std::memory_order_relaxed))
+		worstLoad.store(load, std::memory_order_relaxed);
+
+	activeBands.store(bandCount, std::memory_order_relaxed);
+}
+
+void PerformanceMonitor::clear() noexcept
+{
+	for (auto& bucket : buckets)
+		bucket.store(0, std::memory_order_relaxed);
+
+	for (auto* counter : { &blocks, &samples, &overloads, &coefficientUpdates, &totalNs, &worstNs, &totalCycles })
+		counter->store(0, std::memory_order_relaxed);
+
+	totalLoad.store(0.0, std::memory_order_relaxed);
+	worstLoad.store(0.0, std::memory_order_relaxed);
+}
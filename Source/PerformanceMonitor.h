@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    Opt-in block timing for the processor, readable from any thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <chrono>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+/**
+	Per-instance processing statistics: block times with a log-scale histogram for
+	percentiles, CPU cycles, coefficient rebuilds and the number of active bands.
+
+	The audio thread is the only writer. Every counter is a relaxed atomic it
+	updates with a plain load and store, so recording is wait-free and readers
+	on any other thread never block it. A reading is only consistent counter by
+	counter, which is plenty for a monitor.
+
+	While disabled, the audio thread does nothing but check the enabled flag once
+	per block. Setting the PARAMETRIC_EQ_PERF_DIR environment variable enables
+	every instance and has them written to a JSON file in that directory once a
+	second, for monitoring from outside the host.
+*/
+class PerformanceMonitor
+{
+public:
+	struct Snapshot
+	{
+		juce::String name;
+		juce::uint64 blocks = 0, samples = 0, overloads = 0, coefficientUpdates = 0;
+		double meanBlockUs = 0, worstBlockUs = 0;
+		double p50BlockUs = 0, p99BlockUs = 0, p999BlockUs = 0;
+		double cyclesPerSample = 0;
+
+		//block time as a fraction of the block's own duration, 1.0 is the real-time limit
+		double meanLoad = 0, worstLoad = 0;
+		int activeBands = 0;
+
+		juce::var toVar() const;
+	};
+
+	PerformanceMonitor();
+	~PerformanceMonitor();
+
+	void setEnabled(bool shouldBeEnabled) noexcept { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+	bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+	/** Any thread: clears the statistics, which the audio thread does at its next block. */
+	void reset() noexcept { resetRequested.store(true, std::memory_order_relaxed); }
+
+	/** Message thread: the name to report this instance under, usually the host's track name. */
+	void setName(const juce::String& newName);
+
+	void prepare(double newSampleRate) noexcept { sampleRate.store(newSampleRate, std::memory_order_relaxed); }
+
+	/** Audio thread: counts coefficient rebuilds towards the current block. */
+	void countCoefficientUpdates(int count) noexcept { pendingUpdates += (juce::uint64) count; }
+
+	/** Audio thread: times everything from construction to destruction as one block. */
+	class ScopedBlock
+	{
+	public:
+		ScopedBlock(PerformanceMonitor& monitorToUse, int numSamples) noexcept
+			: monitor(monitorToUse.isEnabled() ? &monitorToUse : nullptr), samples(numSamples)
+		{
+			if (monitor == nullptr)
+				return;
+
+			monitor->pendingUpdates = 0;
+			startCycles = readCycleCounter();
+			start = std::chrono::steady_clock::now();
+		}
+
+		~ScopedBlock()
+		{
+			if (monitor != nullptr)
+				monitor->record((juce::uint64) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+								readCycleCounter() - startCycles, samples, activeBands);
+		}
+
+		bool isActive() const noexcept { return monitor != nullptr; }
+		void setActiveBands(int count) noexcept { activeBands = count; }
+
+	private:
+		PerformanceMonitor* monitor;
+		int samples, activeBands = 0;
+		juce::uint64 startCycles = 0;
+		std::chrono::steady_clock::time_point start;
+
+		JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+	};
+
+	/** Any thread: the statistics since the monitor was enabled or last reset. */
+	Snapshot getSnapshot() const;
+
+private:
+	class Dump;
+
+	static juce::uint64 readCycleCounter() noexcept
+	{
+	#if JUCE_INTEL
+		return (juce::uint64) __rdtsc();
+	#else
+		return 0;
+	#endif
+	}
+
+	//eight buckets per octave, so a percentile is within 12.5% of the real block time
+	static constexpr int subBucketBits = 3;
+	static constexpr int minOctave = 6;
+	static constexpr int numOctaves = 32 - minOctave;
+	static constexpr int numBuckets = numOctaves << subBucketBits;
+
+	static int getBucket(juce::uint64 ns) noexcept;
+	static double getBucketUpperUs(int bucket) noexcept;
+
+	void record(juce::uint64 ns, juce::uint64 cycles, int numSamples, int activeBands) noexcept;
+	void clear() noexcept;
+	double getPercentileUs(const std::array<juce::uint32, numBuckets>& counts, juce::uint64 total, double fraction) const noexcept;
+
+	//the audio thread is the only writer, so no read-modify-write is needed
+	template <typename Type>
+	static void add(std::atomic<Type>& counter, Type amount) noexcept
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	std::atomic<bool> enabled { false }, resetRequested { false };
+	std::atomic<double> sampleRate { 44100.0 };
+
+	std::array<std::atomic<juce::uint32>, numBuckets> buckets {};
+	std::atomic<juce::uint64> blocks { 0 }, samples { 0 }, overloads { 0 }, coefficientUpdates { 0 };
+	std::atomic<juce::uint64> totalNs { 0 }, worstNs { 0 }, totalCycles { 0 };
+	std::atomic<double> totalLoad { 0.0 }, worstLoad { 0.0 };
+	std::atomic<int> activeBands { 0 };
+
+	//audio thread only
+	juce::uint64 pendingUpdates = 0;
+
+	juce::CriticalSection nameLock;
+	juce::String name;
+
+	juce::SharedResourcePointer<Dump> dump;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceMonitor)
+};
@@ -14,9 +14,26 @@ Parametric_EQ_PluginAudioProcessorEditor::Parametric_EQ_PluginAudioProcessorEdit
 	Parametric_EQ_PluginAudioProcessor& p)
 	: AudioProcessorEditor(&p), audioProcessor(p)
 {
-	setSize(1280, 600);
-	
+	auto& monitor = audioProcessor.getPerformanceMonitor();
+
+	monitorButton.setToggleState(monitor.isEnabled(), juce::dontSendNotification);
+	monitorButton.onClick = [this, &monitor]
+	{
+		monitor.reset();
+		monitor.setEnabled(monitorButton.getToggleState());
+	};
+
+	resetButton.onClick = [&monitor] { monitor.reset(); };
+	monitorLabel.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 13.0f, juce::Font::plain));
+
+	addAndMakeVisible(display);
+	addAndMakeVisible(parameterEditor);
+	addAndMakeVisible(monitorButton);
+	addAndMakeVisible(resetButton);
+	addAndMakeVisible(monitorLabel);
 
+	setSize(1280, 600);
+	startTimerHz(4);
 }
 
 Parametric_EQ_PluginAudioProcessorEditor::~Parametric_EQ_PluginAudioProcessorEditor()
@@ -27,12 +44,43 @@ Parametric_EQ_PluginAudioProcessorEditor::~Parametric_EQ_PluginAudioProcessorEdi
 void Parametric_EQ_PluginAudioProcessorEditor::paint(juce::Graphics& g)
 {
 	g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
-
-	g.setColour(juce::Colours::white);
-	g.setFont(15.0f);
-	g.drawFittedText("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
 void Parametric_EQ_PluginAudioProcessorEditor::resized()
 {
+	auto bounds = getLocalBounds();
+	auto monitorBar = bounds.removeFromBottom(28).reduced(4, 2);
+
+	monitorButton.setBounds(monitorBar.removeFromLeft(170));
+	resetButton.setBounds(monitorBar.removeFromLeft(60));
+	monitorLabel.setBounds(monitorBar.withTrimmedLeft(8));
+	display.setBounds(bounds.removeFromTop(bounds.getHeight() / 2).reduced(4));
+	parameterEditor.setBounds(bounds);
+}
+
+void Parametric_EQ_PluginAudioProcessorEditor::timerCallback()
+{
+	const auto& monitor = audioProcessor.getPerformanceMonitor();
+
+	if (! monitor.isEnabled())
+	{
+		monitorLabel.setText({}, juce::dontSendNotification);
+		return;
+	}
+
+	const auto reading = monitor.getSnapshot();
+	juce::String text;
+
+	text << "block us mean " << juce::String(reading.meanBlockUs, 1)
+		 << "  p50 " << juce::String(reading.p50BlockUs, 1)
+		 << "  p99 " << juce::String(reading.p99BlockUs, 1)
+		 << "  p99.9 " << juce::String(reading.p999BlockUs, 1)
+		 << "  worst " << juce::String(reading.worstBlockUs, 1)
+		 << "  |  load " << juce::String(reading.meanLoad * 100.0, 1) << "% (worst " << juce::String(reading.worstLoad * 100.0, 1) << "%)"
+		 << "  overloads " << juce::String((juce::int64) reading.overloads)
+		 << "  |  cycles/sample " << juce::String(reading.cyclesPerSample, 1)
+		 << "  coefficient updates " << juce::String((juce::int64) reading.coefficientUpdates)
+		 << "  bands " << reading.activeBands;
+
+	monitorLabel.setText(text, juce::dontSendNotification);
 }
@@ -10,11 +10,13 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "EQDisplay.h"
 
 //==============================================================================
 /**
 */
-class Parametric_EQ_PluginAudioProcessorEditor  : public juce::AudioProcessorEditor
+class Parametric_EQ_PluginAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                                  private juce::Timer
 {
 public:
     Parametric_EQ_PluginAudioProcessorEditor (Parametric_EQ_PluginAudioProcessor&);
@@ -25,8 +27,17 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
 
     Parametric_EQ_PluginAudioProcessor& audioProcessor;
 
+    EQDisplay display { audioProcessor };
+    juce::GenericAudioProcessorEditor parameterEditor { audioProcessor };
+
+    //performance readings, only gathered while the button is on
+    juce::ToggleButton monitorButton { "Performance monitor" };
+    juce::TextButton resetButton { "Reset" };
+    juce::Label monitorLabel;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Parametric_EQ_PluginAudioProcessorEditor)
 };
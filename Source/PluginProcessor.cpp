@@ -7,7 +7,15 @@
 */
 
 #include "PluginProcessor.h"
+
+//set to 1 to build the processor without its editor, for command line hosts like the batch renderer
+#ifndef EQ_HEADLESS
+#define EQ_HEADLESS 0
+#endif
+
+#if ! EQ_HEADLESS
 #include "PluginEditor.h"
+#endif
 
 //==============================================================================
 Parametric_EQ_PluginAudioProcessor::Parametric_EQ_PluginAudioProcessor()
@@ -16,16 +24,27 @@ Parametric_EQ_PluginAudioProcessor::Parametric_EQ_PluginAudioProcessor()
 #if ! JucePlugin_IsMidiEffect
 #if ! JucePlugin_IsSynth
 		.withInput("Input", juce::AudioChannelSet::stereo(), true)
+		.withInput("Sidechain", juce::AudioChannelSet::stereo(), false)
 #endif
 		.withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
 	)
 #endif
 {
+	markAllBandsDirty();
+
+	for (auto* param : getParameters())
+		if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param))
+			apvts.addParameterListener(ranged->paramID, this);
 }
 
 Parametric_EQ_PluginAudioProcessor::~Parametric_EQ_PluginAudioProcessor()
 {
+	cancelPendingUpdate();
+
+	for (auto* param : getParameters())
+		if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param))
+			apvts.removeParameterListener(ranged->paramID, this);
 }
 
 //==============================================================================
@@ -63,7 +82,19 @@ bool Parametric_EQ_PluginAudioProcessor::isMidiEffect() const
 
 double Parametric_EQ_PluginAudioProcessor::getTailLengthSeconds() const
 {
-	return 0.0;
+	const auto sampleRate = getSampleRate();
+
+	if (sampleRate <= 0.0)
+		return 0.0;
+
+	//the delay comes first, then the FIR's second half in linear phase or the longest band's ring otherwise
+	const auto delaySeconds = getLatencySamples() / sampleRate;
+	const auto options = engineParameters.load();
+
+	if (options.linearPhase)
+		return delaySeconds + (options.firLength / 2) / sampleRate;
+
+	return delaySeconds + EQEngine::getRingSeconds(parameters.load(), options);
 }
 
 int Parametric_EQ_PluginAudioProcessor::getNumPrograms()
@@ -93,21 +124,49 @@ void Parametric_EQ_PluginAudioProcessor::changeProgramName(int index, const juce
 //==============================================================================
 void Parametric_EQ_PluginAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-	juce::dsp::ProcessSpec spec;
+	const PreparedSetup setup { sampleRate, samplesPerBlock, getTotalNumOutputChannels(), isUsingDoublePrecision(), isNonRealtime() };
+
+	//hosts call this again on transport and routing changes, when nothing it depends on has moved the filters keep
+	//their state and coefficients, and settings changed in the meantime are picked up by the next block as usual
+	if (prepared && setup == preparedSetup)
+	{
+		reportLatency();
+		return;
+	}
 
-	spec.maximumBlockSize = samplesPerBlock;
-	spec.numChannels = 1;
-	spec.sampleRate = sampleRate;
+	preparedSetup = setup;
 
-	leftChannel.prepare(spec);
-	rightChannel.prepare(spec);
+	performanceMonitor.prepare(sampleRate);
+	analyzer.prepare(sampleRate);
+	performanceMonitor.reset();
 
-	peakFilterUpdate(getChainSettings(apvts));
+	//every band is built from the settings read after this, a change landing later sets its flag again
+	markAllBandsDirty();
+	takeDirtyBands();
 
+	appliedVersion = settingsVersion.load();
+	currentSettings = parameters.load();
+
+	auto options = engineParameters.load();
+	options.nonRealtime = isNonRealtime();
+
+	engine.prepare({ sampleRate, samplesPerBlock, getTotalNumOutputChannels(), isUsingDoublePrecision() }, currentSettings, options);
+	reportLatency();
+
+	prepared = true;
 }
 
 void Parametric_EQ_PluginAudioProcessor::releaseResources()
 {
+	//an idle instance keeps its parameters and little else, the next prepareToPlay builds everything again
+	prepared = false;
+	engine.release();
+}
+
+void Parametric_EQ_PluginAudioProcessor::reset()
+{
+	//clears what the filters have heard and nothing else, so it's cheap enough for every transport jump
+	engine.reset();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -117,12 +176,9 @@ bool Parametric_EQ_PluginAudioProcessor::isBusesLayoutSupported(const BusesLayou
     juce::ignoreUnused (layouts);
     return true;
 #else
-	// This is the place where you check if the layout is supported.
-	// In this template code we only support mono or stereo.
-	// Some plugin hosts, such as certain GarageBand versions, will only
-	// load plugins that support stereo bus layouts.
-	if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-		&& layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+	// The cascade is sized from the bus at prepareToPlay, so any layout works,
+	// from mono through surround and ambisonics, as long as the bus is enabled.
+	if (layouts.getMainOutputChannelSet().isDisabled())
 		return false;
 
 	// This checks if the input layout matches the output layout
@@ -138,86 +194,335 @@ bool Parametric_EQ_PluginAudioProcessor::isBusesLayoutSupported(const BusesLayou
 
 void Parametric_EQ_PluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-	juce::ScopedNoDenormals noDenormals;
-	const auto totalNumInputChannels = getTotalNumInputChannels();
+	juce::ignoreUnused(midiMessages);
+	processSamples(buffer);
+}
+
+void Parametric_EQ_PluginAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+	juce::ignoreUnused(midiMessages);
+	processSamples(buffer);
+}
+
+bool Parametric_EQ_PluginAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+	return true;
+}
+
+template <typename SampleType>
+void Parametric_EQ_PluginAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
+{
+	//released, there are no filters, tables or oversamplers to run until the host prepares again
+	if (! prepared.load())
+		return;
+
+	const auto totalNumInputChannels = getMainBusNumInputChannels();
 	const auto totalNumOutputChannels = getTotalNumOutputChannels();
 
+	//times the whole block, coefficient rebuilds included, when monitoring is switched on
+	PerformanceMonitor::ScopedBlock timing(performanceMonitor, buffer.getNumSamples());
 
 	for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
 		buffer.clear(i, 0, buffer.getNumSamples());
 
+	auto options = engineParameters.load();
+	options.nonRealtime = isNonRealtime();
+	engine.setOptions(options);
+
+	//the flags are taken before the settings are read, so a band whose change lands in between is rebuilt next block,
+	//and after a state recall every band jumps straight to its new settings
+	const auto changed = takeDirtyBands();
+	const auto settings = readSettings();
+	engine.setSettings(settings, changed, snapToSettings.exchange(false));
+
+	if (timing.isActive())
+		timing.setActiveBands(countActiveBands(settings));
+
+	const auto block = juce::dsp::AudioBlock<SampleType>(buffer).getSubsetChannelBlock(0, (size_t) totalNumOutputChannels);
 
-	peakFilterUpdate(getChainSettings(apvts));
-	shelfFilterUpdate(getChainSettings(apvts));
+	//the key is the sidechain when it is switched on and connected, otherwise the main input
+	const auto useSidechain = sidechainParam->load() >= 0.5f && getBusCount(true) > 1 && getChannelCountOfBus(true, 1) > 0;
+	auto keyBuffer = getBusBuffer(buffer, true, useSidechain ? 1 : 0);
+	const auto key = juce::dsp::AudioBlock<const SampleType>(keyBuffer.getArrayOfReadPointers(), (size_t) keyBuffer.getNumChannels(),
+															 (size_t) keyBuffer.getNumSamples());
 
-	const juce::dsp::AudioBlock<float> block(buffer);
+	analyzer.push(SpectrumAnalyzer::Pre, block);
+	engine.process(block, key);
+	analyzer.push(SpectrumAnalyzer::Post, block);
 
-	auto left_channel_block = block.getSingleChannelBlock(0);
-	auto right_channel_block = block.getSingleChannelBlock(1);
+	updateLatency();
 
-	juce::dsp::ProcessContextReplacing<float> left_context(left_channel_block);
-	juce::dsp::ProcessContextReplacing<float> right_context(right_channel_block);
+	//the designer only runs once linear phase has been used, and can only be started from the message thread
+	if (engine.needsDesigner())
+		triggerAsyncUpdate();
 
-	leftChannel.process(left_context);
-	rightChannel.process(right_context);
+	performanceMonitor.countCoefficientUpdates(engine.takeCoefficientUpdates());
 }
 
 //==============================================================================
 bool Parametric_EQ_PluginAudioProcessor::hasEditor() const
 {
-	return true; // (change this to false if you choose to not supply an editor)
+	return ! EQ_HEADLESS; // (change this to false if you choose to not supply an editor)
 }
 
 juce::AudioProcessorEditor* Parametric_EQ_PluginAudioProcessor::createEditor()
 {
-	// return new Parametric_EQ_PluginAudioProcessorEditor(*this);
-	return new juce::GenericAudioProcessorEditor(*this);
+#if EQ_HEADLESS
+	return nullptr;
+#else
+	return new Parametric_EQ_PluginAudioProcessorEditor(*this);
+#endif
 }
 
 
 //==============================================================================
 void Parametric_EQ_PluginAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-	// You should use this method to store your parameters in the memory block.
-	// You could do that either as raw data, or use the XML or ValueTree classes
-	// as intermediaries to make it easy to save and load complex data.
+	//a few hundred bytes of plain values, rather than an XML document that has to be parsed back on every session load
+	juce::MemoryOutputStream stream(destData, false);
+	const auto& params = getParameters();
+
+	stream.writeInt((int) stateMagic);
+	stream.writeShort((short) stateVersion);
+	stream.writeShort((short) params.size());
+
+	//values are stored in real units rather than normalised, so they keep their meaning if a range is changed later
+	for (auto* param : params)
+	{
+		auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param);
+		jassert(ranged != nullptr);
+
+		stream.writeString(ranged->paramID);
+		stream.writeFloat(ranged->convertFrom0to1(ranged->getValue()));
+	}
 }
 
 void Parametric_EQ_PluginAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-	// You should use this method to restore your parameters from this memory block,
-	// whose contents will have been created by the getStateInformation() call.
+	if (! readBinaryState(data, sizeInBytes) && ! readLegacyState(data, sizeInBytes))
+		return;
+
+	//every changed parameter has already bumped the settings version, this just stops the next block ramping to them
+	snapToSettings.store(true);
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+bool Parametric_EQ_PluginAudioProcessor::readBinaryState(const void* data, int sizeInBytes)
+{
+	constexpr int headerSize = 8, valueSize = 4;
+
+	const auto* read = static_cast<const char*>(data);
+	const auto* end = read + sizeInBytes;
+
+	if (data == nullptr || sizeInBytes < headerSize || juce::ByteOrder::littleEndianInt(read) != stateMagic)
+		return false;
+
+	//later versions may only append to the format, so a newer state is read as far as this version understands it
+	const auto version = (int) juce::ByteOrder::littleEndianShort(read + 4);
+	const auto numValues = (int) juce::ByteOrder::littleEndianShort(read + 6);
+	read += headerSize;
+
+	if (version < 1)
+		return false;
+
+	//the whole state is checked before anything is applied, so a truncated one leaves the current settings alone
+	const auto& params = getParameters();
+	std::vector<float> values((size_t) params.size(), std::numeric_limits<float>::quiet_NaN());
+
+	for (int i = 0; i < numValues; ++i)
+	{
+		const auto* idEnd = std::find(read, end, '\0');
+
+		if (idEnd == end || end - (idEnd + 1) < valueSize)
+			return false;
+
+		//states are written in parameter order, so the ID nearly always matches without a lookup
+		auto* ranged = i < params.size() ? dynamic_cast<juce::RangedAudioParameter*>(params[i]) : nullptr;
+
+		if (ranged == nullptr || ranged->paramID != read)
+			ranged = apvts.getParameter(juce::String::fromUTF8(read, (int) (idEnd - read)));
+
+		const auto bits = juce::ByteOrder::littleEndianInt(idEnd + 1);
+		read = idEnd + 1 + valueSize;
+
+		//parameters this version no longer has are skipped
+		if (ranged == nullptr)
+			continue;
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		values[(size_t) ranged->getParameterIndex()] = value;
+	}
+
+	//parameters added since the state was saved go back to their defaults
+	for (int i = 0; i < params.size(); ++i)
+		if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(params[i]))
+			applyParameterValue(*ranged, std::isnan(values[(size_t) i]) ? ranged->getDefaultValue() : ranged->convertTo0to1(values[(size_t) i]));
+
+	return true;
+}
+
+bool Parametric_EQ_PluginAudioProcessor::readLegacyState(const void* data, int sizeInBytes)
+{
+	//sessions saved as the APVTS XML tree
+	const auto xml = getXmlFromBinary(data, sizeInBytes);
+
+	if (xml == nullptr || ! xml->hasTagName(apvts.state.getType()))
+		return false;
+
+	apvts.replaceState(juce::ValueTree::fromXml(*xml));
+	return true;
+}
+
+void Parametric_EQ_PluginAudioProcessor::applyParameterValue(juce::RangedAudioParameter& param, float normalisedValue)
+{
+	//unchanged parameters are left alone, so recalling a mostly default state notifies the host and listeners only for what moved
+	if (param.getValue() != normalisedValue)
+		param.setValueNotifyingHost(normalisedValue);
+}
+
+ChainParameters::ChainParameters(juce::AudioProcessorValueTreeState& apvts)
+	: lowCutFreq(apvts.getRawParameterValue("LOWCUTFREQ")),
+	  lowCutSlope(apvts.getRawParameterValue("LOWCUTSLOPE")),
+	  lowShelfFreq(apvts.getRawParameterValue("LOWSHELFFREQ")),
+	  lowShelfGain(apvts.getRawParameterValue("LOWSHELFGAIN")),
+	  lowShelfQ(apvts.getRawParameterValue("LOWSHELFQ")),
+	  lowMidFreq(apvts.getRawParameterValue("LOWMIDPEAKFREQ")),
+	  lowMidGain(apvts.getRawParameterValue("LOWMIDPEAKGAIN")),
+	  lowMidQ(apvts.getRawParameterValue("LOWMIDPEAKQ")),
+	  midFreq(apvts.getRawParameterValue("MIDPEAKFREQ")),
+	  midGain(apvts.getRawParameterValue("MIDPEAKGAIN")),
+	  midQ(apvts.getRawParameterValue("MIDPEAKQ")),
+	  hiShelfFreq(apvts.getRawParameterValue("HISHELFFREQ")),
+	  hiShelfGain(apvts.getRawParameterValue("HISHELFGAIN")),
+	  hiShelfQ(apvts.getRawParameterValue("HISHELFQ")),
+	  hiCutFreq(apvts.getRawParameterValue("HICUTFREQ")),
+	  hiCutSlope(apvts.getRawParameterValue("HICUTSLOPE"))
+{
+}
+
+ChainSettings ChainParameters::load() const noexcept
 {
 	ChainSettings settings;
 
-	settings.lowCutFreq = apvts.getRawParameterValue("LOWCUTFREQ")->load();
-	settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LOWCUTSLOPE")->load());
+	settings.lowCutFreq = lowCutFreq->load();
+	settings.lowCutSlope = static_cast<Slope>(lowCutSlope->load());
 
-	settings.lowShelfFreq = apvts.getRawParameterValue("LOWSHELFFREQ")->load();
-	settings.lowShelfGainDB = apvts.getRawParameterValue("LOWSHELFGAIN")->load();
-	settings.lowShelfQ = apvts.getRawParameterValue("LOWSHELFQ")->load();
+	settings.lowShelfFreq = lowShelfFreq->load();
+	settings.lowShelfGainDB = lowShelfGain->load();
+	settings.lowShelfQ = lowShelfQ->load();
 
-	settings.lowMidFreq = apvts.getRawParameterValue("LOWMIDPEAKFREQ")->load();
-	settings.lowMidGainDB = apvts.getRawParameterValue("LOWMIDPEAKGAIN")->load();
-	settings.lowMidQ = apvts.getRawParameterValue("LOWMIDPEAKQ")->load();
+	settings.lowMidFreq = lowMidFreq->load();
+	settings.lowMidGainDB = lowMidGain->load();
+	settings.lowMidQ = lowMidQ->load();
 
-	settings.midFreq = apvts.getRawParameterValue("MIDPEAKFREQ")->load();
-	settings.midGainDB = apvts.getRawParameterValue("MIDPEAKGAIN")->load();
-	settings.midQ = apvts.getRawParameterValue("MIDPEAKQ")->load();
+	settings.midFreq = midFreq->load();
+	settings.midGainDB = midGain->load();
+	settings.midQ = midQ->load();
 
-	settings.hiShelfFreq = apvts.getRawParameterValue("HISHELFFREQ")->load();
-	settings.hiShelfGainDB = apvts.getRawParameterValue("HISHELFGAIN")->load();
-	settings.hiShelfQ = apvts.getRawParameterValue("HISHELFQ")->load();
+	settings.hiShelfFreq = hiShelfFreq->load();
+	settings.hiShelfGainDB = hiShelfGain->load();
+	settings.hiShelfQ = hiShelfQ->load();
 
-	settings.hiCutFreq = apvts.getRawParameterValue("HICUTFREQ")->load();
-	settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HICUTSLOPE")->load());
+	settings.hiCutFreq = hiCutFreq->load();
+	settings.highCutSlope = static_cast<Slope>(hiCutSlope->load());
 
 	return settings;
 }
 
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+	return ChainParameters(apvts).load();
+}
+
+void setChainSettings(juce::AudioProcessorValueTreeState& apvts, const ChainSettings& settings)
+{
+	const auto set = [&apvts](const char* id, float value)
+	{
+		auto* param = apvts.getParameter(id);
+		jassert(param != nullptr);
+		param->setValueNotifyingHost(param->convertTo0to1(value));
+	};
+
+	set("LOWCUTFREQ", settings.lowCutFreq);
+	set("LOWCUTSLOPE", (float) settings.lowCutSlope);
+	set("LOWSHELFFREQ", settings.lowShelfFreq);
+	set("LOWSHELFGAIN", settings.lowShelfGainDB);
+	set("LOWSHELFQ", settings.lowShelfQ);
+	set("LOWMIDPEAKFREQ", settings.lowMidFreq);
+	set("LOWMIDPEAKGAIN", settings.lowMidGainDB);
+	set("LOWMIDPEAKQ", settings.lowMidQ);
+	set("MIDPEAKFREQ", settings.midFreq);
+	set("MIDPEAKGAIN", settings.midGainDB);
+	set("MIDPEAKQ", settings.midQ);
+	set("HISHELFFREQ", settings.hiShelfFreq);
+	set("HISHELFGAIN", settings.hiShelfGainDB);
+	set("HISHELFQ", settings.hiShelfQ);
+	set("HICUTFREQ", settings.hiCutFreq);
+	set("HICUTSLOPE", (float) settings.highCutSlope);
+}
+
+EngineParameters::EngineParameters(juce::AudioProcessorValueTreeState& apvts)
+	: smoothingStep(apvts.getRawParameterValue("SMOOTHSTEP")),
+	  oversampling(apvts.getRawParameterValue("OVERSAMPLING")),
+	  precision(apvts.getRawParameterValue("PRECISION")),
+	  stereoMode(apvts.getRawParameterValue("STEREOMODE")),
+	  bandChannels { apvts.getRawParameterValue("LOWCUTCHANNEL"),
+					 apvts.getRawParameterValue("LOWSHELFCHANNEL"),
+					 apvts.getRawParameterValue("LOWMIDPEAKCHANNEL"),
+					 apvts.getRawParameterValue("MIDPEAKCHANNEL"),
+					 apvts.getRawParameterValue("HISHELFCHANNEL"),
+					 apvts.getRawParameterValue("HICUTCHANNEL") },
+	  phaseMode(apvts.getRawParameterValue("PHASEMODE")),
+	  firLength(apvts.getRawParameterValue("FIRLENGTH")),
+	  dynamicRanges { apvts.getRawParameterValue("LOWSHELFDYNRANGE"),
+					  apvts.getRawParameterValue("LOWMIDPEAKDYNRANGE"),
+					  apvts.getRawParameterValue("MIDPEAKDYNRANGE"),
+					  apvts.getRawParameterValue("HISHELFDYNRANGE") },
+	  dynamicThresholds { apvts.getRawParameterValue("LOWSHELFDYNTHRESHOLD"),
+						  apvts.getRawParameterValue("LOWMIDPEAKDYNTHRESHOLD"),
+						  apvts.getRawParameterValue("MIDPEAKDYNTHRESHOLD"),
+						  apvts.getRawParameterValue("HISHELFDYNTHRESHOLD") },
+	  dynamicAttack(apvts.getRawParameterValue("DYNATTACK")),
+	  dynamicRelease(apvts.getRawParameterValue("DYNRELEASE"))
+{
+}
+
+EQEngine::Options EngineParameters::load() const noexcept
+{
+	EQEngine::Options options;
+
+	static constexpr int steps[] = { 0, 64, 32, 16, 8, 1 };
+	options.smoothingStep = steps[juce::jlimit(0, (int) std::size(steps) - 1, (int) smoothingStep->load())];
+
+	options.oversamplingFactor = 1 << juce::jlimit(0, 2, (int) oversampling->load());
+	options.mixedPrecision = precision->load() >= 0.5f;
+
+	//choice 0 is both channels, 1 the mid or left and 2 the side or right
+	options.stereoMode = (EQEngine::StereoMode) juce::jlimit(0, 2, (int) stereoMode->load());
+
+	for (size_t i = 0; i < bandChannels.size(); ++i)
+		options.bandChannels[i] = juce::jlimit(0, 2, (int) bandChannels[i]->load()) - 1;
+
+	options.linearPhase = phaseMode->load() >= 0.5f;
+	options.firLength = LinearPhaseEQ::minFirLength << juce::jlimit(0, 3, (int) firLength->load());
+
+	for (size_t i = 0; i < dynamicRanges.size(); ++i)
+	{
+		options.dynamicRanges[i] = dynamicRanges[i]->load();
+		options.dynamicThresholds[i] = dynamicThresholds[i]->load();
+	}
+
+	options.dynamicAttackMs = dynamicAttack->load();
+	options.dynamicReleaseMs = dynamicRelease->load();
+
+	return options;
+}
+
+EQEngine::Options getEngineOptions(juce::AudioProcessorValueTreeState& apvts)
+{
+	return EngineParameters(apvts).load();
+}
+
 juce::AudioProcessorValueTreeState::ParameterLayout Parametric_EQ_PluginAudioProcessor::createParamLayout()
 {
 	//createing parameter layout, mapping all values to sliders
@@ -261,120 +566,162 @@ juce::AudioProcessorValueTreeState::ParameterLayout Parametric_EQ_PluginAudioPro
 	param_layout.add(std::make_unique<juce::AudioParameterFloat>("HICUTFREQ", "Hi Cut Freq",juce::NormalisableRange<float>(20.0f, 20000.f, 1.0f, 0.8f), 20000.0f));
 	param_layout.add(std::make_unique<juce::AudioParameterChoice>("HICUTSLOPE", "Hi Cut Slope", choicesArray, 0.0f));
 
+	//Dynamic gain for the peak and shelf bands, a range of 0 dB keeps a band static
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("LOWSHELFDYNRANGE", "Low Shelf Dynamic Range", juce::NormalisableRange<float>(-24.0f, 24.0f, 0.5f, 1.0f), 0.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("LOWSHELFDYNTHRESHOLD", "Low Shelf Threshold", juce::NormalisableRange<float>(-60.0f, 0.0f, 0.5f, 1.0f), -24.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("LOWMIDPEAKDYNRANGE", "Low Mid Dynamic Range", juce::NormalisableRange<float>(-24.0f, 24.0f, 0.5f, 1.0f), 0.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("LOWMIDPEAKDYNTHRESHOLD", "Low Mid Threshold", juce::NormalisableRange<float>(-60.0f, 0.0f, 0.5f, 1.0f), -24.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("MIDPEAKDYNRANGE", "Mid Dynamic Range", juce::NormalisableRange<float>(-24.0f, 24.0f, 0.5f, 1.0f), 0.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("MIDPEAKDYNTHRESHOLD", "Mid Threshold", juce::NormalisableRange<float>(-60.0f, 0.0f, 0.5f, 1.0f), -24.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("HISHELFDYNRANGE", "Hi Shelf Dynamic Range", juce::NormalisableRange<float>(-24.0f, 24.0f, 0.5f, 1.0f), 0.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("HISHELFDYNTHRESHOLD", "Hi Shelf Threshold", juce::NormalisableRange<float>(-60.0f, 0.0f, 0.5f, 1.0f), -24.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("DYNATTACK", "Dynamic Attack", juce::NormalisableRange<float>(0.1f, 100.0f, 0.1f, 0.4f), 5.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterFloat>("DYNRELEASE", "Dynamic Release", juce::NormalisableRange<float>(5.0f, 2000.0f, 1.0f, 0.3f), 150.0f));
+	param_layout.add(std::make_unique<juce::AudioParameterBool>("DYNSIDECHAIN", "Dynamic Sidechain", false));
+
+	//Coefficient smoothing, how often a ramping band has its coefficients rebuilt
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("SMOOTHSTEP", "Smoothing Step", juce::StringArray { "Off", "64 Samples", "32 Samples", "16 Samples", "8 Samples", "1 Sample" }, 2));
+
+	//Oversampling, for bands close to Nyquist
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("OVERSAMPLING", "Oversampling", juce::StringArray { "Off", "2x", "4x" }, 0));
+
+	//Stereo mode, and which channel of the mid/side or left/right pair each band works on
+	const auto bandChannels = juce::StringArray { "Both", "Mid / Left", "Side / Right" };
+
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("STEREOMODE", "Stereo Mode", juce::StringArray { "Linked", "Mid/Side", "Left/Right" }, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("LOWCUTCHANNEL", "Low Cut Channel", bandChannels, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("LOWSHELFCHANNEL", "Low Shelf Channel", bandChannels, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("LOWMIDPEAKCHANNEL", "Low Mid Channel", bandChannels, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("MIDPEAKCHANNEL", "Mid Channel", bandChannels, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("HISHELFCHANNEL", "Hi Shelf Channel", bandChannels, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("HICUTCHANNEL", "Hi Cut Channel", bandChannels, 0));
+
+	//Single or mixed precision filters, double precision hosts always get double precision
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("PRECISION", "Filter Precision", juce::StringArray { "Single", "Mixed" }, 0));
+
+	//Linear phase mode and its FIR length
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("PHASEMODE", "Phase Mode", juce::StringArray { "Minimum Phase", "Linear Phase" }, 0));
+	param_layout.add(std::make_unique<juce::AudioParameterChoice>("FIRLENGTH", "Linear Phase Length", juce::StringArray { "8192", "16384", "32768", "65536" }, 1));
+
 
 	return param_layout;
 }
 
-void Parametric_EQ_PluginAudioProcessor::peakFilterUpdate(ChainSettings& settings)
+void Parametric_EQ_PluginAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
 {
-	
-	auto lowMidPeakCoe = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(), settings.lowMidFreq, settings.lowMidQ, juce::Decibels::decibelsToGain(settings.lowMidGainDB));
-	auto midPeakCoe = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(), settings.midFreq, settings.midQ, juce::Decibels::decibelsToGain(settings.midGainDB));
+	juce::ignoreUnused(newValue);
+
+	const auto pos = chainPosForParameter(parameterID);
 
-	updateCoefficients(leftChannel.get<ChainPos::LowMidPeak>().coefficients, lowMidPeakCoe);
-	updateCoefficients(rightChannel.get<ChainPos::LowMidPeak>().coefficients, lowMidPeakCoe);
-	updateCoefficients(leftChannel.get<ChainPos::MidPeak>().coefficients, midPeakCoe);
-	updateCoefficients(rightChannel.get<ChainPos::MidPeak>().coefficients, midPeakCoe);
+	//only the curve moves the version, everything else the audio thread polls itself each block
+	if (pos == ChainPos::NumChainPos)
+		return;
+
+	//the version moves first, so an audio thread that sees the flag also sees a new version and rereads the value
+	settingsVersion.fetch_add(1, std::memory_order_release);
+	bandDirty[pos].store(true, std::memory_order_release);
 }
 
-void Parametric_EQ_PluginAudioProcessor::cutFilterUpdate(ChainSettings& settings)
+void Parametric_EQ_PluginAudioProcessor::updateTrackProperties(const TrackProperties& properties)
 {
+	//the track name is what tells instances apart in the performance readings
+	if (properties.name.isNotEmpty())
+		performanceMonitor.setName(properties.name);
+}
 
-	auto cutCoe = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(settings.lowCutFreq, getSampleRate(), 2 * (settings.lowCutSlope + 1));
-	auto& leftLowCut = leftChannel.get<ChainPos::LowCut>();
+EQEngine::ChainPos Parametric_EQ_PluginAudioProcessor::chainPosForParameter(const juce::String& parameterID)
+{
+	//the dynamic and channel parameters share a band's prefix but aren't part of its ChainSettings curve
+	if (parameterID.contains("DYN") || parameterID.endsWith("CHANNEL"))
+		return ChainPos::NumChainPos;
+
+	if (parameterID.startsWith("LOWCUT"))
+		return ChainPos::LowCut;
+	if (parameterID.startsWith("LOWSHELF"))
+		return ChainPos::LowShelf;
+	if (parameterID.startsWith("LOWMIDPEAK"))
+		return ChainPos::LowMidPeak;
+	if (parameterID.startsWith("MIDPEAK"))
+		return ChainPos::MidPeak;
+	if (parameterID.startsWith("HISHELF"))
+		return ChainPos::HiShelf;
+	if (parameterID.startsWith("HICUT"))
+		return ChainPos::HiCut;
+
+	return ChainPos::NumChainPos;
+}
 
-	leftLowCut.setBypassed<0>(true);
-	leftLowCut.setBypassed<1>(true);
-	leftLowCut.setBypassed<2>(true);
-	leftLowCut.setBypassed<3>(true);
+int Parametric_EQ_PluginAudioProcessor::countActiveBands(const ChainSettings& settings) noexcept
+{
+	return (settings.lowCutFreq > CoefficientTables::minFreq ? 1 : 0)
+		 + (settings.lowShelfGainDB != 0.0f ? 1 : 0)
+		 + (settings.lowMidGainDB != 0.0f ? 1 : 0)
+		 + (settings.midGainDB != 0.0f ? 1 : 0)
+		 + (settings.hiShelfGainDB != 0.0f ? 1 : 0)
+		 + (settings.hiCutFreq < CoefficientTables::maxFreq ? 1 : 0);
+}
 
-	switch (settings.lowCutSlope)
-	{
-	case Slope12:
-		*leftLowCut.get<0>().coefficients = *cutCoe[0];
-		leftLowCut.setBypassed<0>(false);
-		break;
-	case Slope24:
-		*leftLowCut.get<0>().coefficients = *cutCoe[0];
-		leftLowCut.setBypassed<0>(false);
-		*leftLowCut.get<1>().coefficients = *cutCoe[1];
-		leftLowCut.setBypassed<1>(false);
-		break;
-	case Slope36:
-		*leftLowCut.get<0>().coefficients = *cutCoe[0];
-		leftLowCut.setBypassed<0>(false);
-		*leftLowCut.get<1>().coefficients = *cutCoe[1];
-		leftLowCut.setBypassed<1>(false);
-		*leftLowCut.get<2>().coefficients = *cutCoe[2];
-		leftLowCut.setBypassed<2>(false);
-		break;
-	case Slope48:
-		*leftLowCut.get<0>().coefficients = *cutCoe[0];
-		leftLowCut.setBypassed<0>(false);
-		*leftLowCut.get<1>().coefficients = *cutCoe[1];
-		leftLowCut.setBypassed<1>(false);
-		*leftLowCut.get<2>().coefficients = *cutCoe[2];
-		leftLowCut.setBypassed<2>(false);
-		*leftLowCut.get<3>().coefficients = *cutCoe[3];
-		leftLowCut.setBypassed<3>(false);
-		break;
-	}
+void Parametric_EQ_PluginAudioProcessor::markAllBandsDirty()
+{
+	for (auto& dirty : bandDirty)
+		dirty.store(true);
+}
+
+EQEngine::BandFlags Parametric_EQ_PluginAudioProcessor::takeDirtyBands()
+{
+	EQEngine::BandFlags changed;
 
-	auto& rightLowCut = rightChannel.get<ChainPos::LowCut>();
+	for (size_t pos = 0; pos < changed.size(); ++pos)
+		changed[pos] = bandDirty[pos].exchange(false, std::memory_order_acq_rel);
 
-	rightLowCut.setBypassed<0>(true);
-	rightLowCut.setBypassed<1>(true);
-	rightLowCut.setBypassed<2>(true);
-	rightLowCut.setBypassed<3>(true);
+	return changed;
+}
 
-	switch (settings.lowCutSlope)
+ChainSettings Parametric_EQ_PluginAudioProcessor::readSettings()
+{
+	//seqlock style: copy the values between two reads of the version and copy again if a change landed in between,
+	//so a block never sees a snapshot torn across a parameter change
+	for (int attempt = 0;; ++attempt)
 	{
-	case Slope12:
-		*rightLowCut.get<0>().coefficients = *cutCoe[0];
-		rightLowCut.setBypassed<0>(false);
-		break;
-	case Slope24:
-		*rightLowCut.get<0>().coefficients = *cutCoe[0];
-		rightLowCut.setBypassed<0>(false);
-		*rightLowCut.get<1>().coefficients = *cutCoe[1];
-		rightLowCut.setBypassed<1>(false);
-		break;
-	case Slope36:
-		*rightLowCut.get<0>().coefficients = *cutCoe[0];
-		rightLowCut.setBypassed<0>(false);
-		*rightLowCut.get<1>().coefficients = *cutCoe[1];
-		rightLowCut.setBypassed<1>(false);
-		*rightLowCut.get<2>().coefficients = *cutCoe[2];
-		rightLowCut.setBypassed<2>(false);
-		break;
-	case Slope48:
-		*rightLowCut.get<0>().coefficients = *cutCoe[0];
-		rightLowCut.setBypassed<0>(false);
-		*rightLowCut.get<1>().coefficients = *cutCoe[1];
-		rightLowCut.setBypassed<1>(false);
-		*rightLowCut.get<2>().coefficients = *cutCoe[2];
-		rightLowCut.setBypassed<2>(false);
-		*rightLowCut.get<3>().coefficients = *cutCoe[3];
-		rightLowCut.setBypassed<3>(false);
-		break;
+		const auto before = settingsVersion.load(std::memory_order_acquire);
+
+		if (before == appliedVersion)
+			return currentSettings;
+
+		const auto settings = parameters.load();
+		const auto after = settingsVersion.load(std::memory_order_acquire);
+
+		//under a constant stream of changes, give up after a few tries and take this copy, the next block reads again
+		if (before == after || attempt == 2)
+		{
+			currentSettings = settings;
+			appliedVersion = before;
+			return settings;
+		}
 	}
 }
 
-void Parametric_EQ_PluginAudioProcessor::shelfFilterUpdate(ChainSettings& settings)
+void Parametric_EQ_PluginAudioProcessor::handleAsyncUpdate()
 {
-	auto lowShelfCoe = juce::dsp::IIR::Coefficients<float>::makeLowShelf(getSampleRate(), settings.lowShelfFreq, settings.lowShelfQ,juce::Decibels::decibelsToGain(settings.lowShelfGainDB));
-	auto hiShelfCoe = juce::dsp::IIR::Coefficients<float>::makeHighShelf(getSampleRate(), settings.hiShelfFreq, settings.hiShelfQ,juce::Decibels::decibelsToGain(settings.hiShelfGainDB));
+	setLatencySamples(latencyToReport.load());
 
+	if (prepared && engineParameters.load().linearPhase)
+		engine.startDesigner();
+}
 
-	updateCoefficients(leftChannel.get<ChainPos::LowShelf>().coefficients, lowShelfCoe);
-	updateCoefficients(rightChannel.get<ChainPos::LowShelf>().coefficients, lowShelfCoe);
-	updateCoefficients(leftChannel.get<ChainPos::HiShelf>().coefficients, hiShelfCoe);
-	updateCoefficients(rightChannel.get<ChainPos::HiShelf>().coefficients, hiShelfCoe);
+void Parametric_EQ_PluginAudioProcessor::reportLatency()
+{
+	latencyToReport.store(engine.getLatencySamples());
+	setLatencySamples(latencyToReport.load());
 }
 
-void Parametric_EQ_PluginAudioProcessor::updateCoefficients(Filter::CoefficientsPtr& oldCoe,const Filter::CoefficientsPtr& newCoe)
+void Parametric_EQ_PluginAudioProcessor::updateLatency()
 {
-	*oldCoe = *newCoe;
+	//hosts expect latency changes from the message thread, so the audio thread only notes the new value and posts it
+	const auto latency = engine.getLatencySamples();
+
+	if (latencyToReport.exchange(latency) != latency)
+		triggerAsyncUpdate();
 }
 
 //==============================================================================
@@ -9,43 +9,69 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "EQEngine.h"
+#include "PerformanceMonitor.h"
+#include "SpectrumAnalyzer.h"
 
 
-enum Slope
-	{
-		Slope12,
-		Slope24,
-		Slope36,
-		Slope48
-	};
-
-struct ChainSettings
+//the parameters' atomic values, looked up by ID once so reading them later costs 16 loads and no string searches
+struct ChainParameters
 {
-	float lowShelfQ{1.0f};
-	float lowMidQ{1.0f};
-	float midQ{1.0f};
-	float hiShelfQ{1.0f};
-	float lowShelfGainDB{0};
-	float lowMidGainDB{0};
-	float midGainDB;
-	float hiShelfGainDB{0};
-	float lowCutFreq{0};
-	float hiCutFreq{0};
-	float lowShelfFreq{0};
-	float lowMidFreq{0};
-	float midFreq{0};
-	float hiShelfFreq{0};
-	Slope lowCutSlope{Slope::Slope12};
-	Slope highCutSlope{Slope::Slope12};
+	explicit ChainParameters(juce::AudioProcessorValueTreeState& apvts);
+
+	ChainSettings load() const noexcept;
+
+	std::atomic<float>* lowCutFreq;
+	std::atomic<float>* lowCutSlope;
+	std::atomic<float>* lowShelfFreq;
+	std::atomic<float>* lowShelfGain;
+	std::atomic<float>* lowShelfQ;
+	std::atomic<float>* lowMidFreq;
+	std::atomic<float>* lowMidGain;
+	std::atomic<float>* lowMidQ;
+	std::atomic<float>* midFreq;
+	std::atomic<float>* midGain;
+	std::atomic<float>* midQ;
+	std::atomic<float>* hiShelfFreq;
+	std::atomic<float>* hiShelfGain;
+	std::atomic<float>* hiShelfQ;
+	std::atomic<float>* hiCutFreq;
+	std::atomic<float>* hiCutSlope;
 };
 
-
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
 
+//the reverse of getChainSettings, for setting up a processor that runs without a host
+void setChainSettings(juce::AudioProcessorValueTreeState& apvts, const ChainSettings& settings);
+
+//the same for the parameters outside the curve, read into the engine's options once per block
+struct EngineParameters
+{
+	explicit EngineParameters(juce::AudioProcessorValueTreeState& apvts);
+
+	EQEngine::Options load() const noexcept;
+
+	std::atomic<float>* smoothingStep;
+	std::atomic<float>* oversampling;
+	std::atomic<float>* precision;
+	std::atomic<float>* stereoMode;
+	std::array<std::atomic<float>*, EQEngine::NumChainPos> bandChannels;
+	std::atomic<float>* phaseMode;
+	std::atomic<float>* firLength;
+	std::array<std::atomic<float>*, DynamicDetector::numBands> dynamicRanges;
+	std::array<std::atomic<float>*, DynamicDetector::numBands> dynamicThresholds;
+	std::atomic<float>* dynamicAttack;
+	std::atomic<float>* dynamicRelease;
+};
+
+EQEngine::Options getEngineOptions(juce::AudioProcessorValueTreeState& apvts);
+
 //==============================================================================
 /**
 */
-class Parametric_EQ_PluginAudioProcessor : public juce::AudioProcessor
+class Parametric_EQ_PluginAudioProcessor : public juce::AudioProcessor,
+                                           public juce::AudioProcessorValueTreeState::Listener,
+                                           private juce::AsyncUpdater
 {
 public:
 	//==============================================================================
@@ -55,12 +81,15 @@ public:
 	//==============================================================================
 	void prepareToPlay(double sampleRate, int samplesPerBlock) override;
 	void releaseResources() override;
+	void reset() override;
 
 #ifndef JucePlugin_PreferredChannelConfigurations
 	bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 #endif
 
 	void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+	void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+	bool supportsDoublePrecisionProcessing() const override;
 
 	//==============================================================================
 	juce::AudioProcessorEditor* createEditor() override;
@@ -88,30 +117,86 @@ public:
 	static juce::AudioProcessorValueTreeState::ParameterLayout createParamLayout();
 	juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Params", createParamLayout()};
 
+	//==============================================================================
+	void parameterChanged(const juce::String& parameterID, float newValue) override;
+	void updateTrackProperties(const TrackProperties& properties) override;
+
+	PerformanceMonitor& getPerformanceMonitor() noexcept { return performanceMonitor; }
+	SpectrumAnalyzer& getAnalyzer() noexcept { return analyzer; }
+
+	/** Moves every time a parameter that shapes the curve changes, so the editor only recomputes it then. */
+	juce::uint32 getSettingsVersion() const noexcept { return settingsVersion.load(std::memory_order_acquire); }
+
 private:
 
-	enum ChainPos
+	using ChainPos = EQEngine::ChainPos;
+
+	//the band whose curve a parameter shapes, or NumChainPos for any parameter outside ChainSettings
+	static ChainPos chainPosForParameter(const juce::String& parameterID);
+	static int countActiveBands(const ChainSettings& settings) noexcept;
+
+	void markAllBandsDirty();
+	EQEngine::BandFlags takeDirtyBands();
+
+	ChainSettings readSettings();
+
+	//what the last prepareToPlay was for, a repeat call with the same setup leaves the running filters alone
+	struct PreparedSetup
 	{
-		LowCut,
-		LowShelf,
-		LowMidPeak,
-		MidPeak,
-		HiShelf,
-		HiCut
+		double sampleRate = 0.0;
+		int blockSize = 0, numChannels = 0;
+		bool doublePrecision = false, nonRealtime = false;
+
+		bool operator== (const PreparedSetup& other) const noexcept
+		{
+			return sampleRate == other.sampleRate && blockSize == other.blockSize && numChannels == other.numChannels
+				&& doublePrecision == other.doublePrecision && nonRealtime == other.nonRealtime;
+		}
 	};
 
-	void peakFilterUpdate(ChainSettings& settings);
-	void cutFilterUpdate(ChainSettings& settings);
-	void shelfFilterUpdate(ChainSettings& settings);
+	//cleared by releaseResources, a block that arrives before the next prepareToPlay passes through untouched
+	PreparedSetup preparedSetup;
+	std::atomic<bool> prepared { false };
+
+	//binary state: magic, format version, value count, then each parameter's ID and plain value
+	static constexpr juce::uint32 stateMagic = 0x53514550; //"PEQS"
+	static constexpr int stateVersion = 1;
+
+	bool readBinaryState(const void* data, int sizeInBytes);
+	bool readLegacyState(const void* data, int sizeInBytes);
+	static void applyParameterValue(juce::RangedAudioParameter& param, float normalisedValue);
+
+	template <typename SampleType>
+	void processSamples(juce::AudioBuffer<SampleType>& buffer);
+
+	void reportLatency();
+	void updateLatency();
+
+	//message thread work the audio thread asks for: reporting a new latency to the host,
+	//and starting the linear phase designer the first time it's needed
+	void handleAsyncUpdate() override;
+	std::atomic<int> latencyToReport { 0 };
+
+	//the signal path itself, this class only feeds it parameters and buses
+	EQEngine engine;
+	const EngineParameters engineParameters { apvts };
+	std::atomic<float>* sidechainParam = apvts.getRawParameterValue("DYNSIDECHAIN");
+
+	//set from parameterChanged (any thread), taken by the audio thread and handed to the engine with the settings read after it
+	std::array<std::atomic<bool>, EQEngine::NumChainPos> bandDirty;
 
-	//Low Cut > Low Shelf > Low Mid Peak > Mid Peak > Hi Shelf > Hi Cut
-	using Filter = juce::dsp::IIR::Filter<float>;
-	using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-	using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, Filter, Filter, Filter, CutFilter>;
+	//bumped by parameterChanged after the new value is stored and before the band's flag is set,
+	//the audio thread rereads the parameters only when it moves
+	const ChainParameters parameters { apvts };
+	std::atomic<juce::uint32> settingsVersion { 0 };
+	juce::uint32 appliedVersion = 0;
+	ChainSettings currentSettings;
 
-	static void updateCoefficients(Filter::CoefficientsPtr& oldCoe, const Filter::CoefficientsPtr& newCoe);
+	//set once a recalled state has been applied, the next block jumps the bands to it instead of ramping
+	std::atomic<bool> snapToSettings { false };
 
-	MonoChain leftChannel, rightChannel;
+	PerformanceMonitor performanceMonitor;
+	SpectrumAnalyzer analyzer;
 
 	//==============================================================================
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Parametric_EQ_PluginAudioProcessor)
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    Pre and post EQ spectrum, analysed off the audio thread for the editor.
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+
+//==============================================================================
+//one for every instance in the process, it only has clients while editors are open
+class SpectrumAnalyzer::AnalysisThread : public juce::TimeSliceThread
+{
+public:
+	AnalysisThread()
+		: juce::TimeSliceThread("EQ Spectrum Analyzer")
+	{
+		startThread();
+	}
+
+	~AnalysisThread() override
+	{
+		stopThread(1000);
+	}
+};
+
+//==============================================================================
+SpectrumAnalyzer::SpectrumAnalyzer()
+{
+	//a full scale sine comes out of the window and transform at 0 dB
+	std::vector<float> ones((size_t) fftSize, 1.0f);
+	window.multiplyWithWindowingTable(ones.data(), (size_t) fftSize);
+
+	magnitudeScale = 2.0f / std::accumulate(ones.begin(), ones.end(), 0.0f);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+	setActive(false);
+}
+
+void SpectrumAnalyzer::setActive(bool shouldBeActive)
+{
+	if (shouldBeActive == active.load())
+		return;
+
+	if (shouldBeActive)
+	{
+		//samples queued before the last close are stale, the analysis thread drops them as the reader
+		discardQueued.store(true);
+		active.store(true);
+		thread->addTimeSliceClient(this);
+	}
+	else
+	{
+		active.store(false);
+		thread->removeTimeSliceClient(this);
+	}
+}
+
+bool SpectrumAnalyzer::getSpectrum(Tap tap, Spectrum& dest) noexcept
+{
+	auto& published = taps[(size_t) tap].published;
+
+	if (! published.update())
+		return false;
+
+	dest = published.read();
+	return true;
+}
+
+//==============================================================================
+int SpectrumAnalyzer::useTimeSlice()
+{
+	const auto discard = discardQueued.exchange(false);
+
+	for (auto& state : taps)
+		analyse(state, discard);
+
+	//a little faster than the display refreshes
+	return 15;
+}
+
+void SpectrumAnalyzer::analyse(TapState& state, bool discard)
+{
+	int start1, size1, start2, size2;
+	state.fifo.prepareToRead(state.fifo.getNumReady(), start1, size1, start2, size2);
+
+	if (discard)
+	{
+		state.fifo.finishedRead(size1 + size2);
+		std::fill(state.average.begin(), state.average.end(), 0.0f);
+		state.frameFill = 0;
+		return;
+	}
+
+	for (auto [start, size] : { std::make_pair(start1, size1), std::make_pair(start2, size2) })
+	{
+		const auto* data = state.ring.data() + start;
+
+		while (size > 0)
+		{
+			const auto count = juce::jmin(size, fftSize - state.frameFill);
+
+			std::copy(data, data + count, state.frame.begin() + state.frameFill);
+			state.frameFill += count;
+			data += count;
+			size -= count;
+
+			if (state.frameFill == fftSize)
+			{
+				analyseFrame(state);
+
+				//frames overlap by half, the second half of this one starts the next
+				std::copy(state.frame.begin() + hopSize, state.frame.end(), state.frame.begin());
+				state.frameFill = fftSize - hopSize;
+			}
+		}
+	}
+
+	state.fifo.finishedRead(size1 + size2);
+
+	if (! state.analysed)
+		return;
+
+	state.analysed = false;
+	auto& spectrum = state.published.getWriteBuffer();
+
+	for (int bin = 0; bin < numBins; ++bin)
+		spectrum[(size_t) bin] = juce::jmax(minDecibels, 10.0f * std::log10(state.average[(size_t) bin] + 1.0e-20f));
+
+	state.published.publish();
+}
+
+void SpectrumAnalyzer::analyseFrame(TapState& state)
+{
+	std::copy(state.frame.begin(), state.frame.end(), fftBuffer.begin());
+	std::fill(fftBuffer.begin() + fftSize, fftBuffer.end(), 0.0f);
+
+	window.multiplyWithWindowingTable(fftBuffer.data(), (size_t) fftSize);
+	fft.performFrequencyOnlyForwardTransform(fftBuffer.data(), true);
+
+	//averaging power rather than dB keeps the display's level honest for noise
+	for (int bin = 0; bin < numBins; ++bin)
+	{
+		const auto magnitude = fftBuffer[(size_t) bin] * magnitudeScale;
+		auto& average = state.average[(size_t) bin];
+
+		average += averaging * (magnitude * magnitude - average);
+	}
+
+	state.analysed = true;
+}
@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    Pre and post EQ spectrum, analysed off the audio thread for the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+//==============================================================================
+/**
+	Feeds the editor's spectrum display. The audio thread mixes each tap down to
+	mono straight into a single producer, single consumer FIFO, which is wait-free
+	and never allocates; whatever doesn't fit is dropped. A background thread
+	shared by every instance windows the samples into half overlapping frames,
+	transforms them and averages the power per bin, then hands the result to the
+	editor through a TripleBuffer.
+
+	Nothing is pushed or analysed unless an editor has switched the analyzer on,
+	so instances with their editor closed pay one flag check per block.
+*/
+class SpectrumAnalyzer : private juce::TimeSliceClient
+{
+public:
+	enum Tap
+	{
+		Pre,
+		Post,
+		NumTaps
+	};
+
+	static constexpr int fftOrder = 12;
+	static constexpr int fftSize = 1 << fftOrder;
+	static constexpr int numBins = fftSize / 2 + 1;
+	static constexpr float minDecibels = -120.0f;
+
+	/** Average power per bin in dB relative to a full scale sine, from DC to Nyquist. */
+	using Spectrum = std::array<float, numBins>;
+
+	SpectrumAnalyzer();
+	~SpectrumAnalyzer() override;
+
+	void prepare(double newSampleRate) noexcept { sampleRate.store(newSampleRate, std::memory_order_relaxed); }
+	double getSampleRate() const noexcept { return sampleRate.load(std::memory_order_relaxed); }
+
+	/** Message thread: starts or stops the analysis, usually as an editor opens and closes. */
+	void setActive(bool shouldBeActive);
+
+	/** Audio thread: queues the block's channel average for the tap. */
+	template <typename SampleType>
+	void push(Tap tap, const juce::dsp::AudioBlock<SampleType>& block) noexcept
+	{
+		if (! active.load(std::memory_order_relaxed))
+			return;
+
+		auto& state = taps[(size_t) tap];
+		const auto numSamples = (int) block.getNumSamples();
+
+		int start1, size1, start2, size2;
+		state.fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+		mixDown(block, 0, state.ring.data() + start1, size1);
+		mixDown(block, size1, state.ring.data() + start2, size2);
+
+		state.fifo.finishedWrite(size1 + size2);
+	}
+
+	/** Editor: copies the tap's latest spectrum into dest, returning false when nothing new was analysed since last time. */
+	bool getSpectrum(Tap tap, Spectrum& dest) noexcept;
+
+private:
+	class AnalysisThread;
+
+	static constexpr int fifoSize = 4 * fftSize;
+	static constexpr int hopSize = fftSize / 2;
+
+	//how much of each new frame goes into the running average, the rest is the previous average
+	static constexpr float averaging = 0.3f;
+
+	struct TapState
+	{
+		juce::AbstractFifo fifo { fifoSize };
+		std::vector<float> ring = std::vector<float>((size_t) fifoSize);
+
+		//analysis thread only
+		std::vector<float> frame = std::vector<float>((size_t) fftSize);
+		std::vector<float> average = std::vector<float>((size_t) numBins);
+		int frameFill = 0;
+		bool analysed = false;
+
+		TripleBuffer<Spectrum> published;
+	};
+
+	template <typename SampleType>
+	static void mixDown(const juce::dsp::AudioBlock<SampleType>& block, int offset, float* dest, int count) noexcept
+	{
+		const auto numChannels = block.getNumChannels();
+
+		if (count <= 0 || numChannels == 0)
+			return;
+
+		const auto scale = 1.0f / (float) numChannels;
+
+		for (size_t ch = 0; ch < numChannels; ++ch)
+		{
+			const auto* source = block.getChannelPointer(ch) + offset;
+
+			for (int i = 0; i < count; ++i)
+				dest[i] = (ch == 0 ? 0.0f : dest[i]) + (float) source[i] * scale;
+		}
+	}
+
+	int useTimeSlice() override;
+	void analyse(TapState& state, bool discard);
+	void analyseFrame(TapState& state);
+
+	std::array<TapState, NumTaps> taps;
+	std::atomic<bool> active { false }, discardQueued { false };
+	std::atomic<double> sampleRate { 44100.0 };
+
+	//analysis thread only
+	juce::dsp::FFT fft { fftOrder };
+	juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+	std::vector<float> fftBuffer = std::vector<float>((size_t) (2 * fftSize));
+	float magnitudeScale = 1.0f;
+
+	juce::SharedResourcePointer<AnalysisThread> thread;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzer)
+};
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    Lock-free hand-off of the latest value from one thread to another.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+	Three slots shared by exactly one writer and one reader. The writer fills its
+	slot and publishes it, the reader picks up the most recently published slot.
+	Neither side ever waits on the other or allocates, and a value published
+	before the reader got to the previous one simply replaces it.
+*/
+template <typename Type>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	/** Writer: the slot to fill before calling publish(). */
+	Type& getWriteBuffer() noexcept { return buffers[(size_t) writeIndex]; }
+
+	/** Writer: makes the filled slot the latest value. */
+	void publish() noexcept
+	{
+		writeIndex = middle.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel) & indexMask;
+	}
+
+	/** Reader: takes the latest value if one was published since the last call, returning false otherwise. */
+	bool update() noexcept
+	{
+		if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+			return false;
+
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	/** Reader: the value taken by the last successful update(). */
+	const Type& read() const noexcept { return buffers[(size_t) readIndex]; }
+
+private:
+	static constexpr int indexMask = 3;
+	static constexpr int newDataFlag = 4;
+
+	std::array<Type, 3> buffers {};
+	std::atomic<int> middle { 1 };
+	int writeIndex = 0, readIndex = 2;
+
+	JUCE_DECLARE_NON_COPYABLE(TripleBuffer)
+};